@@ -0,0 +1,520 @@
+// equation_viz Python extension: the maps, field computation and single orbits of the visualizer
+// without a window. Results are memoryviews over the C++ storage itself (no copy), which NumPy
+// takes as is with numpy.asarray(); the GIL is released while computing, so several Python
+// threads can compute at once.
+//
+//   import equation_viz, numpy as np
+//   m = equation_viz.Map("lorenz", rho=28)
+//   f = equation_viz.compute_field(m, resolution=20, iterations=300)
+//   v = np.asarray(f.vertices)            # (N, 4) float32: x, y, z, speed (visualization space)
+//   t = np.asarray(f.trajectory(0))       # vertices of the first seed's trajectory
+//   o = np.asarray(equation_viz.trace_orbit(equation_viz.Map("henon"), 10**7))  # (n, 3), map space
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../viz/inc/HenonMap.hpp"
+#include "../viz/inc/LorenzMap.hpp"
+#include "../viz/inc/Trajectories.hpp"
+#include "../viz/inc/Seeding.hpp"
+
+// ---------------------------------------------------------------------------------------------
+// Buffer: exports a 1D or 2D array kept alive by `storage` (a field or an orbit) through the
+// buffer protocol. Never returned as is: wrapped in a memoryview.
+
+struct BufferObject {
+    PyObject_HEAD
+    std::shared_ptr<const void> storage;
+    void* data;
+    const char* format;  // "f" (float32) or "i" (int32)
+    Py_ssize_t itemsize, ndim;
+    Py_ssize_t shape[2], strides[2];
+};
+
+static int bufferGet(PyObject* self, Py_buffer* view, int flags) {
+    BufferObject* b = (BufferObject*)self;
+    view->obj = self;
+    Py_INCREF(self);
+    view->buf = b->data;
+    view->len = b->shape[0] * (b->ndim == 2 ? b->shape[1] : 1) * b->itemsize;
+    view->readonly = 0;
+    view->itemsize = b->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? (char*)b->format : nullptr;
+    view->ndim = (int)b->ndim;
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? b->shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? b->strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+static void bufferDealloc(PyObject* self) {
+    ((BufferObject*)self)->storage.~shared_ptr();
+    Py_TYPE(self)->tp_free(self);
+}
+
+static PyBufferProcs bufferProcs = {bufferGet, nullptr};
+
+static PyTypeObject BufferType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+// Memoryview of rows x columns (columns = 0: 1D) elements at data, contiguous
+static PyObject* newBuffer(std::shared_ptr<const void> storage, void* data, const char* format, Py_ssize_t rows,
+                           Py_ssize_t columns) {
+    BufferObject* b = PyObject_New(BufferObject, &BufferType);
+    if (!b) return nullptr;
+    new (&b->storage) std::shared_ptr<const void>(std::move(storage));
+    b->data = data;
+    b->format = format;
+    b->itemsize = 4;
+    b->ndim = columns ? 2 : 1;
+    b->shape[0] = rows;
+    b->shape[1] = columns;
+    b->strides[0] = (columns ? columns : 1) * b->itemsize;
+    b->strides[1] = b->itemsize;
+    PyObject* view = PyMemoryView_FromObject((PyObject*)b);
+    Py_DECREF(b);
+    return view;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Map
+
+struct MapObject {
+    PyObject_HEAD
+    IteratedMap* map;
+};
+
+static PyTypeObject MapType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static bool hasParam(const IteratedMap& map, const std::string& name) {
+    std::vector<std::string> names = map.getParamNames();
+    return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+static int mapInit(PyObject* self, PyObject* args, PyObject* kwargs) {
+    MapObject* m = (MapObject*)self;
+    const char* name = "henon";
+    if (!PyArg_ParseTuple(args, "|s", &name)) return -1;
+    std::unique_ptr<IteratedMap> map;
+    if (std::string(name) == "henon") map = std::make_unique<HenonMap>();
+    else if (std::string(name) == "lorenz") map = std::make_unique<LorenzMap>();
+    else {
+        PyErr_Format(PyExc_ValueError, "unknown map '%s' (henon or lorenz)", name);
+        return -1;
+    }
+
+    // Parameters as keywords, e.g. Map("henon", a=1.4, b=0.3)
+    PyObject *key, *value;
+    Py_ssize_t pos = 0;
+    while (kwargs && PyDict_Next(kwargs, &pos, &key, &value)) {
+        const char* param = PyUnicode_AsUTF8(key);
+        double v = PyFloat_AsDouble(value);
+        if (!param || (v == -1.0 && PyErr_Occurred())) return -1;
+        if (!hasParam(*map, param)) {
+            PyErr_Format(PyExc_ValueError, "%s has no parameter '%s'", map->getName(), param);
+            return -1;
+        }
+        map->setParam(param, (float)v);
+    }
+    delete m->map;
+    m->map = map.release();
+    return 0;
+}
+
+static void mapDealloc(PyObject* self) {
+    delete ((MapObject*)self)->map;
+    Py_TYPE(self)->tp_free(self);
+}
+
+static bool checkMap(PyObject* self) {
+    if (((MapObject*)self)->map) return true;
+    PyErr_SetString(PyExc_RuntimeError, "Map is not initialized");
+    return false;
+}
+
+static PyObject* mapGetParam(PyObject* self, PyObject* arg) {
+    if (!checkMap(self)) return nullptr;
+    const IteratedMap& map = *((MapObject*)self)->map;
+    const char* name = PyUnicode_AsUTF8(arg);
+    if (!name) return nullptr;
+    if (!hasParam(map, name)) return PyErr_Format(PyExc_ValueError, "%s has no parameter '%s'", map.getName(), name);
+    return PyFloat_FromDouble(map.getParam(name));
+}
+
+static PyObject* mapSetParam(PyObject* self, PyObject* args) {
+    if (!checkMap(self)) return nullptr;
+    IteratedMap& map = *((MapObject*)self)->map;
+    const char* name;
+    float value;
+    if (!PyArg_ParseTuple(args, "sf", &name, &value)) return nullptr;
+    if (!hasParam(map, name)) return PyErr_Format(PyExc_ValueError, "%s has no parameter '%s'", map.getName(), name);
+    map.setParam(name, value);
+    Py_RETURN_NONE;
+}
+
+static PyObject* mapIterate(PyObject* self, PyObject* args) {
+    if (!checkMap(self)) return nullptr;
+    float x, y, z;
+    if (!PyArg_ParseTuple(args, "fff", &x, &y, &z)) return nullptr;
+    ((MapObject*)self)->map->iterate(x, y, z);
+    return Py_BuildValue("(fff)", x, y, z);
+}
+
+static PyObject* mapGetName(PyObject* self, void*) {
+    if (!checkMap(self)) return nullptr;
+    return PyUnicode_FromString(((MapObject*)self)->map->getName());
+}
+
+static PyObject* mapGetScale(PyObject* self, void*) {
+    if (!checkMap(self)) return nullptr;
+    return PyFloat_FromDouble(((MapObject*)self)->map->getScale());
+}
+
+static PyObject* mapGetParams(PyObject* self, void*) {
+    if (!checkMap(self)) return nullptr;
+    const IteratedMap& map = *((MapObject*)self)->map;
+    PyObject* params = PyDict_New();
+    if (!params) return nullptr;
+    for (const std::string& name : map.getParamNames()) {
+        PyObject* value = PyFloat_FromDouble(map.getParam(name));
+        if (!value || PyDict_SetItemString(params, name.c_str(), value) < 0) {
+            Py_XDECREF(value);
+            Py_DECREF(params);
+            return nullptr;
+        }
+        Py_DECREF(value);
+    }
+    return params;
+}
+
+static PyMethodDef mapMethods[] = {
+    {"get_param", mapGetParam, METH_O, "get_param(name) -> float"},
+    {"set_param", mapSetParam, METH_VARARGS, "set_param(name, value)"},
+    {"iterate", mapIterate, METH_VARARGS, "iterate(x, y, z) -> (x, y, z): one step, map space"},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+static PyGetSetDef mapGetSets[] = {
+    {"name", mapGetName, nullptr, "Display name", nullptr},
+    {"scale", mapGetScale, nullptr, "Map space = visualization space * scale", nullptr},
+    {"params", mapGetParams, nullptr, "Parameter values by name (a copy)", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+// ---------------------------------------------------------------------------------------------
+// Field: a computed Trajectories, shared with the buffers handed out
+
+struct FieldObject {
+    PyObject_HEAD
+    std::shared_ptr<Trajectories> trajectories;
+};
+
+static PyTypeObject FieldType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static PyObject* newField(std::shared_ptr<Trajectories> trajectories) {
+    FieldObject* f = PyObject_New(FieldObject, &FieldType);
+    if (!f) return nullptr;
+    new (&f->trajectories) std::shared_ptr<Trajectories>(std::move(trajectories));
+    return (PyObject*)f;
+}
+
+static void fieldDealloc(PyObject* self) {
+    ((FieldObject*)self)->trajectories.~shared_ptr();
+    Py_TYPE(self)->tp_free(self);
+}
+
+static Py_ssize_t fieldLength(PyObject* self) {
+    return ((FieldObject*)self)->trajectories->size();
+}
+
+static PyObject* fieldGetVertices(PyObject* self, void*) {
+    const std::shared_ptr<Trajectories>& t = ((FieldObject*)self)->trajectories;
+    return newBuffer(t, t->vertices.data(), "f", (Py_ssize_t)t->vertices.size(), 4);
+}
+
+static PyObject* fieldGetFirsts(PyObject* self, void*) {
+    const std::shared_ptr<Trajectories>& t = ((FieldObject*)self)->trajectories;
+    return newBuffer(t, t->firsts.data(), "i", (Py_ssize_t)t->firsts.size(), 0);
+}
+
+static PyObject* fieldGetCounts(PyObject* self, void*) {
+    const std::shared_ptr<Trajectories>& t = ((FieldObject*)self)->trajectories;
+    return newBuffer(t, t->counts.data(), "i", (Py_ssize_t)t->counts.size(), 0);
+}
+
+static PyObject* fieldGetBounds(PyObject* self, void*) {
+    const Trajectories& t = *((FieldObject*)self)->trajectories;
+    return Py_BuildValue("((fff)(fff))", t.boundsMin[0], t.boundsMin[1], t.boundsMin[2], t.boundsMax[0], t.boundsMax[1],
+                         t.boundsMax[2]);
+}
+
+static PyObject* fieldGetComputedVertices(PyObject* self, void*) {
+    return PyLong_FromSize_t(((FieldObject*)self)->trajectories->computedVertices);
+}
+
+static PyObject* fieldTrajectory(PyObject* self, PyObject* arg) {
+    const std::shared_ptr<Trajectories>& t = ((FieldObject*)self)->trajectories;
+    Py_ssize_t i = PyLong_AsSsize_t(arg);
+    if (i == -1 && PyErr_Occurred()) return nullptr;
+    if (i < 0) i += t->size();
+    if (i < 0 || i >= t->size()) return PyErr_Format(PyExc_IndexError, "trajectory index out of range");
+    return newBuffer(t, t->vertices.data() + t->firsts[i], "f", t->counts[i], 4);
+}
+
+static PyMethodDef fieldMethods[] = {
+    {"trajectory", fieldTrajectory, METH_O, "trajectory(i) -> (count, 4) float32 view of seed i's vertices"},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+static PyGetSetDef fieldGetSets[] = {
+    {"vertices", fieldGetVertices, nullptr, "(N, 4) float32 view: x, y, z (visualization space), step length", nullptr},
+    {"firsts", fieldGetFirsts, nullptr, "int32 view: first vertex of each trajectory", nullptr},
+    {"counts", fieldGetCounts, nullptr, "int32 view: vertex count of each trajectory", nullptr},
+    {"bounds", fieldGetBounds, nullptr, "((xmin, ymin, zmin), (xmax, ymax, zmax))", nullptr},
+    {"computed_vertices", fieldGetComputedVertices, nullptr, "Vertex count before simplification", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+static PySequenceMethods fieldSequence = {fieldLength};
+
+// ---------------------------------------------------------------------------------------------
+// Module functions
+
+// Field settings shared by compute_field and compute_ensemble, after their positional arguments.
+// Resolution and iterations default to the map's own (-1 until parsed).
+#define FIELD_KEYWORDS "resolution", "iterations", "range", "center", "sampling", "seeds", "refine_depth", \
+    "refine_budget", "simplify"
+#define FIELD_FORMAT "|iif(fff)siiif"
+#define FIELD_ARGS(config, sampling) &config.resolution, &config.iterations, &config.range, &config.cx, &config.cy, \
+    &config.cz, &sampling, &config.seedCount, &config.refineDepth, &config.refineBudget, &config.simplify
+
+static bool finishConfig(const IteratedMap& map, const char* sampling, FieldConfig& config) {
+    if (config.resolution == -1) config.resolution = map.getDefaultResolution();
+    if (config.iterations == -1) config.iterations = map.getDefaultIterations();
+    for (config.sampling = 0; config.sampling < SAMPLING_COUNT; config.sampling++) {
+        std::string candidate = samplingName(config.sampling);
+        std::transform(candidate.begin(), candidate.end(), candidate.begin(), ::tolower);
+        if (candidate == sampling) break;
+    }
+    if (config.sampling == SAMPLING_COUNT) {
+        PyErr_Format(PyExc_ValueError, "unknown sampling '%s' (lattice, halton, sobol, jittered or adaptive)", sampling);
+        return false;
+    }
+    if (config.resolution < 2 || config.iterations < 1 || config.seedCount < 1 || config.refineBudget < 1) {
+        PyErr_SetString(PyExc_ValueError, "resolution must be at least 2, iterations, seeds and refine_budget at least 1");
+        return false;
+    }
+    config.refineDepth = std::clamp(config.refineDepth, 0, 10);
+    config.simplify = std::max(0.0f, config.simplify);
+    return true;
+}
+
+static FieldConfig unparsedConfig() {
+    FieldConfig config;
+    config.resolution = config.iterations = -1;
+    return config;
+}
+
+static PyObject* computeFieldPy(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"map", FIELD_KEYWORDS, nullptr};
+    PyObject* mapObject;
+    FieldConfig config = unparsedConfig();
+    const char* sampling = "lattice";
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!" FIELD_FORMAT, (char**)keywords, &MapType, &mapObject,
+                                     FIELD_ARGS(config, sampling)))
+        return nullptr;
+    if (!checkMap(mapObject) || !finishConfig(*((MapObject*)mapObject)->map, sampling, config)) return nullptr;
+
+    // Computed on a copy of the map, which other threads cannot change meanwhile
+    std::unique_ptr<IteratedMap> map = ((MapObject*)mapObject)->map->clone();
+    auto trajectories = std::make_shared<Trajectories>();
+    bool outOfMemory = false;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        computeField(*map, config, *trajectories);
+    } catch (const std::bad_alloc&) {
+        outOfMemory = true;
+    }
+    Py_END_ALLOW_THREADS
+    if (outOfMemory) return PyErr_NoMemory();
+    return newField(std::move(trajectories));
+}
+
+static PyObject* computeEnsemblePy(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"map", "param", "values", FIELD_KEYWORDS, nullptr};
+    PyObject *mapObject, *valueList;
+    const char* param;
+    FieldConfig config = unparsedConfig();
+    const char* sampling = "lattice";
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!sO" FIELD_FORMAT, (char**)keywords, &MapType, &mapObject, &param,
+                                     &valueList, FIELD_ARGS(config, sampling)))
+        return nullptr;
+    if (!checkMap(mapObject) || !finishConfig(*((MapObject*)mapObject)->map, sampling, config)) return nullptr;
+    const IteratedMap& source = *((MapObject*)mapObject)->map;
+    std::vector<std::string> names = source.getParamNames();
+    int paramIndex = (int)(std::find(names.begin(), names.end(), param) - names.begin());
+    if (paramIndex == (int)names.size())
+        return PyErr_Format(PyExc_ValueError, "%s has no parameter '%s'", source.getName(), param);
+
+    PyObject* sequence = PySequence_Fast(valueList, "values must be a sequence of floats");
+    if (!sequence) return nullptr;
+    std::vector<float> values;
+    for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(sequence); i++) {
+        double v = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(sequence, i));
+        if (v == -1.0 && PyErr_Occurred()) {
+            Py_DECREF(sequence);
+            return nullptr;
+        }
+        values.push_back((float)v);
+    }
+    Py_DECREF(sequence);
+
+    std::unique_ptr<IteratedMap> map = source.clone();
+    std::vector<Trajectories> fields;
+    bool outOfMemory = false;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        computeEnsemble(*map, config, paramIndex, values, fields);
+    } catch (const std::bad_alloc&) {
+        outOfMemory = true;
+    }
+    Py_END_ALLOW_THREADS
+    if (outOfMemory) return PyErr_NoMemory();
+
+    PyObject* list = PyList_New((Py_ssize_t)fields.size());
+    if (!list) return nullptr;
+    for (size_t m = 0; m < fields.size(); m++) {
+        PyObject* field = newField(std::make_shared<Trajectories>(std::move(fields[m])));
+        if (!field) {
+            Py_DECREF(list);
+            return nullptr;
+        }
+        PyList_SET_ITEM(list, (Py_ssize_t)m, field);
+    }
+    return list;
+}
+
+// Map is the concrete type so iterate() is inlined (as in single_point_henon); stops early if the orbit escapes
+template <class Map>
+static void traceOrbit(Map map, float x, float y, float z, long long iterations, long long transient, long long every,
+                       std::vector<float>& out) {
+    for (long long n = 0; n < transient; n++) {
+        map.iterate(x, y, z);
+        if (map.hasEscaped(x, y, z)) return;
+    }
+    out.reserve((size_t)((iterations + every - 1) / every) * 3);
+    for (long long n = 0; n < iterations; n++) {
+        if (n % every == 0) out.insert(out.end(), {x, y, z});
+        map.iterate(x, y, z);
+        if (map.hasEscaped(x, y, z)) return;
+    }
+}
+
+static PyObject* traceOrbitPy(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"map", "iterations", "start", "transient", "every", nullptr};
+    PyObject* mapObject;
+    long long iterations, transient = 0, every = 1;
+    float start[3] = {0.1f, 0.1f, 0.1f};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!L|(fff)LL", (char**)keywords, &MapType, &mapObject, &iterations,
+                                     &start[0], &start[1], &start[2], &transient, &every))
+        return nullptr;
+    if (!checkMap(mapObject)) return nullptr;
+    if (iterations < 0 || transient < 0 || every < 1) {
+        PyErr_SetString(PyExc_ValueError, "iterations and transient must be positive, every at least 1");
+        return nullptr;
+    }
+
+    const IteratedMap* map = ((MapObject*)mapObject)->map;
+    auto points = std::make_shared<std::vector<float>>();
+    bool outOfMemory = false;
+    // Copies of the map, taken before releasing the GIL
+    if (auto* henon = dynamic_cast<const HenonMap*>(map)) {
+        HenonMap copy = *henon;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            traceOrbit(copy, start[0], start[1], start[2], iterations, transient, every, *points);
+        } catch (const std::bad_alloc&) {
+            outOfMemory = true;
+        }
+        Py_END_ALLOW_THREADS
+    } else {
+        LorenzMap copy = dynamic_cast<const LorenzMap&>(*map);
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            traceOrbit(copy, start[0], start[1], start[2], iterations, transient, every, *points);
+        } catch (const std::bad_alloc&) {
+            outOfMemory = true;
+        }
+        Py_END_ALLOW_THREADS
+    }
+    if (outOfMemory) return PyErr_NoMemory();
+    return newBuffer(points, points->data(), "f", (Py_ssize_t)points->size() / 3, 3);
+}
+
+static PyMethodDef moduleMethods[] = {
+    {"compute_field", (PyCFunction)(void (*)(void))computeFieldPy, METH_VARARGS | METH_KEYWORDS,
+     "compute_field(map, resolution=None, iterations=None, range=1.0, center=(0, 0, 0), sampling='lattice',\n"
+     "              seeds=1000, refine_depth=5, refine_budget=64000, simplify=0.0) -> Field\n\n"
+     "Trajectories of every seed of the field, as the visualizer computes them (resolution and\n"
+     "iterations default to the map's). The GIL is released meanwhile."},
+    {"compute_ensemble", (PyCFunction)(void (*)(void))computeEnsemblePy, METH_VARARGS | METH_KEYWORDS,
+     "compute_ensemble(map, param, values, **field_settings) -> [Field]\n\n"
+     "One field per value of the map parameter param, computed in one pass from the same seeds."},
+    {"trace_orbit", (PyCFunction)(void (*)(void))traceOrbitPy, METH_VARARGS | METH_KEYWORDS,
+     "trace_orbit(map, iterations, start=(0.1, 0.1, 0.1), transient=0, every=1) -> memoryview\n\n"
+     "(n, 3) float32 points of one orbit in map space, every every-th iterate after the transient,\n"
+     "fewer than iterations / every if it escapes. The GIL is released meanwhile."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+static PyModuleDef moduleDef = {
+    PyModuleDef_HEAD_INIT, "equation_viz",
+    "Henon and Lorenz maps, field and orbit computation; results are zero-copy memoryviews", -1, moduleMethods,
+};
+
+PyMODINIT_FUNC PyInit_equation_viz() {
+    BufferType.tp_name = "equation_viz.Buffer";
+    BufferType.tp_basicsize = sizeof(BufferObject);
+    BufferType.tp_dealloc = bufferDealloc;
+    BufferType.tp_as_buffer = &bufferProcs;
+    BufferType.tp_flags = Py_TPFLAGS_DEFAULT;
+    BufferType.tp_doc = "Storage of a field or orbit array, exported through the buffer protocol";
+
+    MapType.tp_name = "equation_viz.Map";
+    MapType.tp_basicsize = sizeof(MapObject);
+    MapType.tp_dealloc = mapDealloc;
+    MapType.tp_flags = Py_TPFLAGS_DEFAULT;
+    MapType.tp_doc = "Map(name='henon', **params): 'henon' or 'lorenz', parameters as keywords";
+    MapType.tp_methods = mapMethods;
+    MapType.tp_getset = mapGetSets;
+    MapType.tp_init = mapInit;
+    MapType.tp_new = PyType_GenericNew;
+
+    FieldType.tp_name = "equation_viz.Field";
+    FieldType.tp_basicsize = sizeof(FieldObject);
+    FieldType.tp_dealloc = fieldDealloc;
+    FieldType.tp_flags = Py_TPFLAGS_DEFAULT;
+    FieldType.tp_doc = "Computed field: len() trajectories packed in one vertex array";
+    FieldType.tp_methods = fieldMethods;
+    FieldType.tp_getset = fieldGetSets;
+    FieldType.tp_as_sequence = &fieldSequence;
+
+    if (PyType_Ready(&BufferType) < 0 || PyType_Ready(&MapType) < 0 || PyType_Ready(&FieldType) < 0) return nullptr;
+    PyObject* module = PyModule_Create(&moduleDef);
+    if (!module) return nullptr;
+    Py_INCREF(&MapType);
+    Py_INCREF(&FieldType);
+    if (PyModule_AddObject(module, "Map", (PyObject*)&MapType) < 0
+        || PyModule_AddObject(module, "Field", (PyObject*)&FieldType) < 0) {
+        Py_DECREF(&MapType);
+        Py_DECREF(&FieldType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
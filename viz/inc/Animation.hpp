@@ -0,0 +1,40 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../inc/FieldVisualizer.hpp"
+#include "../inc/utils.hpp"
+
+// Keyframed animation script, one directive per line ('#' starts a comment):
+//   fps 30
+//   size 1920 1080
+//   map lorenz                      (optional, overrides the command line)
+//   duration 8                      (optional, defaults to the last keyframe)
+//   keyframe 0 theta=0.5 radius=5 rho=28
+//   keyframe 8 theta=6.8 rho=99
+// Keys: theta phi radius (camera), cx cy cz range resolution iterations seeds (field),
+// anything else is a map parameter. Each key is interpolated linearly between its own keyframes.
+class AnimationScript {
+public:
+    int fps = 30, width = 1280, height = 720;
+    double duration = -1;
+    std::string map;
+
+    // key -> (time, value) keyframes, sorted by time
+    std::map<std::string, std::vector<std::pair<double, double>>> tracks;
+
+    bool load(const std::string& path);
+
+    // Frame n shows time n / fps, whatever the time taken to render it
+    int frameCount() const;
+    double frameTime(int frame) const { return (double)frame / fps; }
+
+    // Set camera, field and map parameters to their values at time t
+    void apply(double t, Camera& cam, FieldVisualizer& field) const;
+};
+
+// Render every frame of the script offscreen to outDir/frame_NNNNNN.png; returns false on error
+bool renderAnimation(const AnimationScript& script, Camera& cam, FieldVisualizer& field, const std::string& outDir);
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Grow-only block of anonymous memory. Growing remaps it (keeping its contents) and nothing is
+// returned to the system before destruction, so refilling up to a previous size neither calls the
+// allocator nor faults pages in again.
+class Arena {
+public:
+    // Back arenas allocated from now on with transparent huge pages (fewer TLB misses and page faults)
+    static bool hugePages;
+
+    Arena() = default;
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&& o) noexcept { swap(o); }
+    Arena& operator=(Arena&& o) noexcept { swap(o); return *this; }
+
+    // Make at least `bytes` available; false if the system refused (contents are kept either way)
+    bool reserve(size_t bytes);
+
+    void* data() const { return base; }
+    size_t capacity() const { return reserved; }
+
+private:
+    void* base = nullptr;
+    size_t reserved = 0;
+
+    void swap(Arena& o) {
+        std::swap(base, o.base);
+        std::swap(reserved, o.reserved);
+    }
+};
+
+// Minimal vector of trivially copyable elements stored in an Arena: clear() and resize() never
+// release memory, and highWater() records the largest size it ever held.
+template <typename T>
+class ArenaVector {
+    static_assert(std::is_trivially_copyable<T>::value, "ArenaVector elements are moved with memcpy");
+
+public:
+    ArenaVector() = default;
+    ArenaVector(ArenaVector&& o) noexcept { swap(o); }
+    ArenaVector& operator=(ArenaVector&& o) noexcept { swap(o); return *this; }
+    ArenaVector(const ArenaVector& o) { *this = o; }
+    ArenaVector& operator=(const ArenaVector& o) {
+        if (this != &o) {
+            resize(o.count);
+            if (count) memcpy(data(), o.data(), count * sizeof(T));
+        }
+        return *this;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t capacity() const { return arena.capacity() / sizeof(T); }
+    size_t highWater() const { return peak; }
+
+    T* data() { return (T*)arena.data(); }
+    const T* data() const { return (const T*)arena.data(); }
+    T& operator[](size_t i) { return data()[i]; }
+    const T& operator[](size_t i) const { return data()[i]; }
+    T* begin() { return data(); }
+    T* end() { return data() + count; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + count; }
+
+    // Like std::vector, running out of memory throws std::bad_alloc
+    void reserve(size_t n) {
+        if (n > capacity() && !arena.reserve(n * sizeof(T))) throw std::bad_alloc();
+    }
+    void resize(size_t n) {
+        reserve(n);
+        count = n;
+        if (count > peak) peak = count;
+    }
+    void clear() { count = 0; }
+
+    // Taken by value: v may be an element of this vector, which growing can move
+    void push_back(T v) {
+        if (count == capacity()) reserve(count ? count * 2 : 1024);
+        data()[count++] = v;
+        if (count > peak) peak = count;
+    }
+
+private:
+    Arena arena;
+    size_t count = 0, peak = 0;
+
+    void swap(ArenaVector& o) {
+        std::swap(arena, o.arena);
+        std::swap(count, o.count);
+        std::swap(peak, o.peak);
+    }
+};
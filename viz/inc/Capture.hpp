@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GLFW/glfw3.h>
+#include <zlib.h>
+
+#include "../inc/FieldVisualizer.hpp"
+
+// Encoder callback: RGB pixels as read by OpenGL (bottom row first, rows tightly packed), or
+// null if the readback could not be mapped (called either way, so captures complete in order)
+using FrameEncoder = std::function<void(const unsigned char* pixels, int width, int height)>;
+
+// Asynchronous framebuffer readback: glReadPixels goes into a pixel buffer object, which is
+// mapped once the GPU is done and handed to background threads without an extra copy.
+// Pixel buffers are reused across captures.
+class AsyncCapture {
+public:
+    AsyncCapture(int slotCount, int workerCount);
+    ~AsyncCapture();
+
+    // Start reading back the current read buffer; false if every slot is still busy (frame dropped)
+    bool capture(int width, int height, FrameEncoder encode);
+
+    // Call once per frame on the GL thread: hand finished readbacks to workers, recycle encoded ones
+    void poll();
+
+    // Block until every pending capture is encoded (GL thread)
+    void finish();
+
+private:
+    enum State { FREE, READING, ENCODING, ENCODED };
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = 0;
+        size_t size = 0;
+        int width = 0, height = 0;
+        const unsigned char* mapped = nullptr;
+        unsigned long long ticket = 0;  // capture order, workers receive slots in this order
+        FrameEncoder encode;
+        std::atomic<int> state{FREE};
+    };
+    std::vector<Slot> slots;
+
+    std::vector<std::thread> workers;
+    std::deque<Slot*> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    unsigned long long nextTicket = 0;
+
+    void workerLoop();
+};
+
+// Continuous recording of every frame, either as numbered image files or as a raw Y4M stream.
+// Frames go through a bounded set of capture buffers; when encoding falls behind, frames are
+// dropped (and counted) instead of stalling the render loop.
+class FrameRecorder {
+public:
+    // PNG_FAST: deflate level 1, PNG_STORE: uncompressed PNG, QOI/PPM: fastest lossless files
+    enum Format { PNG, PNG_FAST, PNG_STORE, QOI, PPM, Y4M };
+
+    // output: directory for image formats, file path or "|command" (pipe) for Y4M; empty picks renders/rec_<timestamp>
+    FrameRecorder(Format format, std::string output, int fps);
+    ~FrameRecorder();
+
+    bool recording() const { return active; }
+    bool start(int width, int height);
+    void stop();
+
+    // Capture the current frame (GL thread, after drawing) and advance encoding
+    void frame(int width, int height);
+    void poll();
+
+    long long recorded = 0, dropped = 0;
+
+    // Offline rendering: wait for a free capture buffer instead of dropping the frame
+    bool dropFrames = true;
+
+private:
+    Format format;
+    std::string output, target;
+    int fps, width = 0, height = 0;
+    bool active = false;
+    AsyncCapture capture;
+
+    // Y4M frames are converted in parallel but written in sequence order
+    FILE* stream = nullptr;
+    bool pipe = false;
+    long long nextWrite = 0;
+    // Set by a worker when the stream stops accepting frames (e.g. the pipe consumer exited)
+    std::atomic<bool> streamFailed{false};
+    // Frames captured but not written: readback or write failed (workers)
+    std::atomic<long long> failed{0};
+    std::mutex writeMutex;
+    std::condition_variable writeTurn;
+
+    void encode(long long index, const unsigned char* pixels, int w, int h);
+};
+
+// Framebuffer object with RGBA8 color and depth renderbuffers, for rendering independently of the window
+class OffscreenBuffer {
+public:
+    OffscreenBuffer(int width, int height);
+    ~OffscreenBuffer();
+
+    // False if the driver rejected the attachments
+    bool valid() const { return complete; }
+
+    // Direct drawing and reading to this buffer until unbind()
+    void bind();
+    void unbind();
+
+    const int width, height;
+
+private:
+    GLuint fbo = 0, color = 0, depth = 0;
+    bool complete = false;
+};
+
+// PNG encoded while its rows arrive (top row first), so images larger than memory can be written
+class PngStream {
+public:
+    ~PngStream();
+
+    bool open(const std::string& path, int width, int height);
+    // width * 3 RGB bytes
+    bool writeRow(const unsigned char* rgb);
+    // Finish the stream; false if anything failed or rows are missing
+    bool close();
+
+private:
+    FILE* file = nullptr;
+    z_stream zs{};
+    bool ok = false;
+    int width = 0, height = 0, rows = 0;
+    std::vector<unsigned char> filtered, compressed;
+
+    void chunk(const char* type, const unsigned char* data, size_t size);
+    void deflateInput(int flush);
+};
+
+// Render the scene at scale x the framebuffer size in framebuffer-sized tiles, each rendered at
+// samples x the resolution in an offscreen buffer and box-filtered down, streamed to a PNG one band
+// of tiles at a time (memory: one band of the output plus one tile). The HUD is not included.
+bool captureTiled(Camera& cam, FieldVisualizer& field, int width, int height, int scale, int samples,
+                  const std::string& path);
+
+// Parse "png", "png-fast", "png-store", "qoi", "ppm" or "y4m"; returns false for anything else
+bool parseRecordFormat(const std::string& name, FrameRecorder::Format& format);
+
+// renders/flow_map_<timestamp>.png (suffix inserted before the extension)
+std::string screenshotPath(const std::string& suffix = "");
+
+// Write RGB pixels (bottom row first, as read by OpenGL) to a PNG, flipping while encoding.
+// Row bands are compressed on `threads` threads (0: all hardware threads), level 0 stores them uncompressed.
+bool writePng(const std::string& path, const unsigned char* pixels, int width, int height, int level = 6, int threads = 0);
+
+// Same for QOI
+bool writeQoi(const std::string& path, const unsigned char* pixels, int width, int height);
+
+// Same for binary PPM (P6): no compression, mostly bound by disk bandwidth
+bool writePpm(const std::string& path, const unsigned char* pixels, int width, int height);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+// Number of entries in a colormap lookup table (1D texture width)
+constexpr int COLORMAP_SIZE = 256;
+
+// Number of selectable colormaps
+int colormapCount();
+
+// Display name of colormap idx
+const char* colormapName(int idx);
+
+// Fill rgb with COLORMAP_SIZE * 3 bytes sampling colormap idx over t in [0, 1]
+void buildColormap(int idx, std::vector<unsigned char>& rgb);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FieldVisualizer.hpp"
+
+// Nearby values of one map parameter side by side: the member fields follow the main field
+// (config, display settings, other parameters), are computed together by computeEnsemble and
+// drawn in a grid of viewports sharing the camera.
+class Ensemble {
+public:
+    static constexpr int MAX_MEMBERS = 16;  // each has a HUD label entry
+
+    int param = 0;          // getParamNames() index of the varied parameter
+    int members = 4;
+    float spread = 0.1f;    // member values span the main field's value -/+ spread (relative)
+
+    // Time of the last ensemble computation
+    double computeMs = 0;
+
+    // Value of the varied parameter in member m
+    float value(const FieldVisualizer& field, int m) const;
+    const std::string& paramName(const FieldVisualizer& field) const;
+
+    // Viewport grid: columns x rows cells, member m's cell at (x, y) from the bottom-left
+    int columns() const;
+    int rows() const;
+    void viewport(int m, int width, int height, int& x, int& y, int& w, int& h) const;
+
+    // Recompute the members if needed and draw them into their viewports
+    void render(Camera& cam, FieldVisualizer& field, int width, int height);
+
+    // Vertices drawn / in the fields, over all members
+    long long drawnVertices() const;
+    long long fieldVertices() const;
+
+    // Chunks drawn / culled by the last render, over all members (each culls against its own viewport)
+    int drawnChunks() const;
+    int culledChunks() const;
+
+private:
+    std::vector<std::unique_ptr<FieldVisualizer>> fields;
+    // Member values and storage of the current computation, kept to reuse their capacity
+    std::vector<float> values;
+    std::vector<Trajectories*> targets;
+
+    // Copy the main field's settings and parameters into the members
+    void follow(const FieldVisualizer& field);
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "IteratedMap.hpp"
+#include "Trajectories.hpp"
+
+// Computed fields (trajectories with their LODs) kept on disk across runs, one file per map, map
+// parameters and field config, named after a hash of them. Files are read back through mmap;
+// the directory is kept under maxBytes by removing the least recently used files (by mtime,
+// which a hit refreshes). Files are written by a background thread, one at a time.
+class FieldCache {
+public:
+    std::string directory;
+    long long maxBytes = 2048LL << 20;
+
+    // Only fields that took at least this long to compute are stored: cheaper ones are not worth the disk
+    double minComputeMs = 20.0;
+    // ... and only once their settings stayed unchanged this long (not every step while a key is held)
+    double storeDelaySeconds = 1.0;
+
+    // Stats: hits / misses so far and time of the last load (caller's thread); stores so far, files
+    // and bytes in the directory (updated by the writer)
+    int hits = 0, misses = 0;
+    double lastLoadMs = 0;
+    std::atomic<int> stores{0}, files{0};
+    std::atomic<long long> bytes{0};
+
+    FieldCache() = default;
+    ~FieldCache();
+
+    // Creates the directory if needed; false (cache disabled) if it cannot
+    bool open(const std::string& path);
+    bool enabled() const { return !directory.empty(); }
+
+    // Fill out with the cached field, if there is one
+    bool load(const IteratedMap& map, const FieldConfig& config, Trajectories& out);
+    // Start writing a field computed in computeMs in the background (to a temporary file, renamed
+    // when complete), then evict. traj is read until the write ends: cancelStore() before changing it.
+    void store(const IteratedMap& map, const FieldConfig& config, const Trajectories& traj, double computeMs);
+    // Stop the write in progress, if any (its temporary file is removed)
+    void cancelStore();
+
+    // Everything that identifies a field, and its 64-bit FNV-1a hash
+    static std::string describe(const IteratedMap& map, const FieldConfig& config);
+    static uint64_t hash(const std::string& description);
+
+private:
+    std::thread writer;
+    std::atomic<bool> cancelled{false};
+
+    std::string path(const std::string& description) const;
+    bool write(const std::string& description, const std::string& file, const Trajectories& traj);
+    // Remove least recently used files until the directory fits in maxBytes, and recount it
+    void evict();
+};
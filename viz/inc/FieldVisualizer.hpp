@@ -3,6 +3,7 @@
 #include <GLFW/glfw3.h>
 #include <GL/freeglut.h>
 #include <GL/glu.h>
+#include <array>
 #include <vector>
 #include <cmath>
 #include <string>
@@ -15,17 +16,177 @@
 #include "../inc/IteratedMap.hpp"
 #include "../inc/HenonMap.hpp"
 #include "../inc/LorenzMap.hpp"
+#include "../inc/Trajectories.hpp"
+#include "../inc/LargeField.hpp"
+#include "../inc/Poincare.hpp"
+#include "../inc/PerfCounters.hpp"
+#include "../inc/FieldCache.hpp"
+#include "../inc/utils.hpp"
 
 
 class FieldVisualizer {
 public:
     std::unique_ptr<IteratedMap> map;
+    // Most map parameters a field tracks (getParamNames().size())
+    static constexpr int MAX_PARAMS = 8;
     int resolution = 10, iterations = 15;
     float range = 1.0f;
     float cx = 0, cy = 0, cz = 0;
+    int sampling = 0, seedCount = 1000;  // seed strategy (Seeding.hpp), seed count when not a lattice
+    int refineDepth = 5, refineBudget = 40 * 40 * 40;  // adaptive sampling: max splits per coarse cell, max seeds
+
+    // Coloring: selected colormap and speed -> [0, 1] normalization factor
+    int colormap = 0;
+    float speedScale = 1.0f / 1.5f;
+
+    // Level of detail: max on-screen deviation (pixels) allowed when drawing decimated trajectories
+    float lodErrorPx = 0.5f;
+
+    // Polyline simplification tolerance in visualization units (0 = off), applied when computing
+    float simplify = 0.002f;
+
+    // Point cloud mode: vertices drawn as round sprites of pointSize visualization units (attenuated
+    // with distance, at least one pixel), added up with pointAlpha each
+    bool points = false;
+    float pointSize = 0.004f, pointAlpha = 0.35f;
+
+    // GPU vertex format: quantized CompactVertex (8 bytes) or float TrajectoryVertex (16 bytes)
+    bool compact = true;
+
+    // Stats of the last draw() call
+    long long drawnVertices = 0, fieldVertices = 0;
+    int drawnChunks = 0, culledChunks = 0;
+
+    // Hardware counters around field computation (PerfCounters), summarized with its time
+    bool countKernels = false;
+    std::string computeCounters;
+
+    // On-disk cache of computed fields (not owned, nullptr = always compute)
+    FieldCache* cache = nullptr;
+
+    // Trajectories (seeds) of the computed field, and its vertices before / after simplification
+    int fieldTrajectories() const { return trajectories.size(); }
+    long long computedVertices() const { return (long long)trajectories.computedVertices; }
+    long long simplifiedVertices() const { return (long long)trajectories.simplifiedVertices; }
+
+    // Trajectory storage (CPU vertex arena) in use and its high-water mark, in bytes
+    long long storeBytes() const { return (long long)trajectories.vertexBytes(); }
+    long long storeHighWater() const { return (long long)trajectories.highWaterBytes(); }
+
+    // Vertex buffer size and quantization loss: max position error on screen (pixels, at the
+    // nearest point of the field) and max speed error in colormap entries
+    long long bufferBytes = 0;
+    float positionErrorPx = 0, colorErrorSteps = 0;
 
     FieldVisualizer(std::unique_ptr<IteratedMap> m);
+    ~FieldVisualizer();
+
+    FieldConfig config() const;
+
+    // Map parameter names (getParamNames(), queried once) and their current values in that order
+    const std::vector<std::string>& paramNames() const { return names; }
+    std::vector<float> params() const;
+
+    // True if the config or map parameters changed since the field was computed
+    bool stale() const;
 
-    void draw();
+    // Use trajectories computed elsewhere (with LODs built) for the current config and parameters
+    void adopt(Trajectories computedField);
+    // Or compute them into the field's own storage, keeping its capacity (the cache writer is
+    // stopped first), then call adoptInPlace()
+    Trajectories& fieldStorage();
+    void adoptInPlace();
+
+    // Show a single orbit file (loadOrbit, at most maxPoints) instead, until the field settings change
+    bool loadOrbit(const std::string& path, long long maxPoints);
+
+    // Large-field mode: density of a resolution^3 lattice computed in the background (see LargeFieldJob).
+    // The regular field is drawn until the density is ready, then replaced by one point per occupied voxel.
+    // Changing the field config or map parameters starts it over (restarts counts how many times).
+    void startLargeField(int largeResolution, int gridSize);
+    void stopLargeField();
+    bool largeFieldActive() const { return (bool)largeField; }
+    float largeFieldProgress() const { return largeField ? largeField->progress() : 0.0f; }
+    int largeFieldRestarts() const { return largeRestarts; }
+
+    // Poincare section of the field's seeds accumulated in the background (see PoincareJob), shown
+    // as a 2D overlay in the top-right corner that refreshes while it is computing
+    void startPoincare(const PoincareConfig& config);
+    void stopPoincare();
+    PoincareJob* poincareSection() { return poincare.get(); }
+    void drawPoincare(int fbWidth, int fbHeight);
+
+    void draw(const Camera& cam, int viewportHeight);
     void drawBox();
+
+private:
+    Trajectories trajectories;
+    FieldConfig computedConfig;
+    // Compared in place every frame: staleness checks do not allocate
+    std::vector<std::string> names;
+    std::array<float, MAX_PARAMS> computedParams{};
+    bool computed = false;
+    std::vector<int> drawFirsts, drawCounts;
+    LineMesh box;  // unit cube edges, scaled to the field range when drawn
+
+    // Computed field not stored in the cache yet: its compute time and when it was computed
+    bool storePending = false;
+    double storeComputeMs = 0;
+    std::chrono::steady_clock::time_point computedAt;
+
+    CompactVertices quantized;
+    bool uploadedCompact = false;
+
+    struct FieldProgram {
+        GLuint id = 0;
+        GLint uSpeedScale = -1, uAlpha = -1, uColormap = -1;
+        GLint uOrigin = -1, uExtent = -1, uMaxSpeed = -1;  // compact format only
+        GLint uPointSize = -1;
+        void create(const char* vertexShader, const char* fragmentShader);
+    };
+    FieldProgram fullProgram, compactProgram, densityProgram, pointProgram, compactPointProgram;
+    std::unique_ptr<LargeFieldJob> largeField;
+    // Config and parameters the large field was started for, and its size
+    FieldConfig largeBase;
+    std::array<float, MAX_PARAMS> largeParams{};
+    int largeResolution = 0, largeGridSize = 0, largeRestarts = 0;
+    std::unique_ptr<PerfCounters> counters;
+    std::unique_ptr<PoincareJob> poincare;
+    GLuint poincareTexture = 0;
+    double poincareUploaded = -1;  // time of the last texture refresh, -1 before the first
+    bool poincareFinal = false;    // the uploaded section is the finished one
+    GLuint densityVbo = 0;
+    int densityPoints = -1;  // -1 until the finished density is uploaded
+
+    GLuint vbo = 0, colormapTexture = 0;
+    long long vboCapacity = 0;
+    int uploadedColormap = -1;
+
+    // Recompute and re-upload trajectories if the field or map parameters changed
+    void update();
+    // Fill the vertex buffer in the selected format
+    void upload();
+    // Upload and record the config and parameters the trajectories were computed for
+    void fieldChanged();
+    // Cancel the cache write reading the trajectories, and forget the pending one
+    void stopCacheStore();
+    // Upload the density once the large field is done; false while it is still computing
+    bool densityReady();
+    // (Re)start the large field for the current config and parameters
+    void launchLargeField();
+    // Current map parameters, in paramNames() order, and whether they equal values
+    void currentParams(std::array<float, MAX_PARAMS>& values) const;
+    bool paramsEqual(const std::array<float, MAX_PARAMS>& values) const;
 };
+
+// Part of an image rendered as a grid of width x height tiles (column / row counted from the bottom-left)
+struct ViewTile {
+    int column = 0, row = 0;
+    int columns = 1, rows = 1;
+};
+
+// Clear and draw grid, field box and field with the camera's perspective (restricted to one tile if given)
+void renderScene(Camera& cam, FieldVisualizer& field, int width, int height, const ViewTile& tile = ViewTile());
+
+// Draw the same into the width x height viewport at (x, y), without clearing
+void renderView(Camera& cam, FieldVisualizer& field, int x, int y, int width, int height, const ViewTile& tile = ViewTile());
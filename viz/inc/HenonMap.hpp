@@ -18,6 +18,15 @@ public:
         z = nz;
     }
 
+    bool trace(TraceBatch& batch) override {
+        if (activeIsa() == ISA_SCALAR) return false;
+        HenonParams params;
+        batch.laneParam(0, a, params.a);
+        batch.laneParam(1, b, params.b);
+        traceHenon(params, batch);
+        return true;
+    }
+
     float getParam(const std::string& name) const override {
         if (name == "a") return a;
         if (name == "b") return b;
@@ -29,6 +38,14 @@ public:
         if (name == "b") b = value;
     }
 
+    std::vector<std::string> getParamNames() const override {
+        return {"a", "b"};
+    }
+
+    std::unique_ptr<IteratedMap> clone() const override {
+        return std::make_unique<HenonMap>(*this);
+    }
+
     const char* getName() const override {
         return "Henon Map";
     }
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// In-memory image encoders. Input is RGB as read by OpenGL (bottom row first, rows tightly packed),
+// output images are stored top row first. `out` is overwritten and can be reused between calls.
+
+// PNG whose rows are split into bands deflated concurrently and joined into one zlib stream
+// (threads <= 0: one band per hardware thread). Level 0 stores rows uncompressed: largest but
+// close to memcpy speed. False (and out empty) if deflate fails.
+bool encodePng(const unsigned char* pixels, int width, int height, std::vector<unsigned char>& out,
+               int level = 6, int threads = 0);
+
+// QOI ("Quite OK Image" format): lossless, single pass, much faster than deflate
+void encodeQoi(const unsigned char* pixels, int width, int height, std::vector<unsigned char>& out);
+
+// QOI decoder following the specification, to RGBA top row first (checks encodeQoi's output)
+bool decodeQoi(const std::vector<unsigned char>& data, int& width, int& height, std::vector<unsigned char>& rgba);
+
+// Binary PPM (P6): header and flipped rows
+void encodePpm(const unsigned char* pixels, int width, int height, std::vector<unsigned char>& out);
+
+bool writeFile(const std::string& path, const std::vector<unsigned char>& data);
+
+// Encode the image with every encoder (and stb_image_write for reference), printing size and throughput
+void benchmarkEncoders(const unsigned char* pixels, int width, int height);
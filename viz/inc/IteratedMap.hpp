@@ -3,15 +3,28 @@
 #include <cmath>
 #include <array>
 #include <string>
+#include <vector>
+#include <memory>
+
+#include "MapKernels.hpp"
 
 // Base class for iterated maps (x_{n+1} = f(x_n, y_n, z_n))
 class IteratedMap {
 public:
     virtual ~IteratedMap() = default;
 
+    // Independent copy with the same parameters (used to compute several fields in parallel)
+    virtual std::unique_ptr<IteratedMap> clone() const = 0;
+
     // Core iteration: compute next point given current point
     virtual void iterate(float& x, float& y, float& z) = 0;
 
+    // Trace a batch of seeds with the vectorized kernels; false if this map has none or the scalar
+    // variant is selected, callers then iterate() seed by seed
+    virtual bool trace(TraceBatch& batch) {
+        return false;
+    }
+
     // Check if trajectory has escaped (prevents visual artifacts)
     virtual bool hasEscaped(float x, float y, float z) const {
         return std::abs(x) > 10.0f;
@@ -28,6 +41,11 @@ public:
     // Set parameter by name (optional, for generic param handling)
     virtual void setParam(const std::string& name, float value) {}
 
+    // Names of the parameters exposed through getParam/setParam
+    virtual std::vector<std::string> getParamNames() const {
+        return {};
+    }
+
     // Get name of this map
     virtual const char* getName() const = 0;
 
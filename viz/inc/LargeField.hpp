@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "IteratedMap.hpp"
+#include "Trajectories.hpp"
+
+// Visit counts of trajectory vertices on a size^3 voxel grid spanning [min, max], incremented
+// concurrently by the workers and read in place once they are done (never copied: 512^3 is 512 MB)
+class DensityGrid {
+public:
+    int size = 0;
+    float min[3] = {0, 0, 0}, max[3] = {0, 0, 0};
+    std::unique_ptr<std::atomic<uint32_t>[]> counts;
+
+    // One vertex per occupied voxel at its center, speed holding log(1 + count) / log(1 + maxCount)
+    void toVertices(std::vector<TrajectoryVertex>& out) const;
+};
+
+// Out-of-core computation of lattices too large to keep as trajectories (e.g. 512^3 seeds):
+// worker threads take one slab of the lattice (resolution^2 seeds) at a time, iterate it and
+// reduce every vertex into a shared density grid, keeping nothing else. Memory is the grid alone
+// (4 bytes per voxel, hence at most 512^3).
+class LargeFieldJob {
+public:
+    // The grid bounds come from a small preview lattice over the same field, padded by 10%
+    LargeFieldJob(const IteratedMap& map, const FieldConfig& config, int gridSize);
+    ~LargeFieldJob();
+
+    float progress() const { return (float)slabsDone / config.resolution; }
+    bool done() const { return slabsDone == config.resolution; }
+
+    // Valid once done()
+    const DensityGrid& result();
+
+    const FieldConfig config;
+
+private:
+    std::unique_ptr<IteratedMap> map;
+    DensityGrid grid;
+    std::atomic<int> nextSlab{0}, slabsDone{0};
+    std::atomic<bool> cancelled{false};
+    std::vector<std::thread> workers;
+
+    void workerLoop();
+};
@@ -28,6 +28,18 @@ public:
         }
     }
 
+    bool trace(TraceBatch& batch) override {
+        if (activeIsa() == ISA_SCALAR) return false;
+        LorenzParams params;
+        batch.laneParam(0, sigma, params.sigma);
+        batch.laneParam(1, rho, params.rho);
+        batch.laneParam(2, beta, params.beta);
+        params.dt = dt;
+        params.substeps = substeps;
+        traceLorenz(params, batch);
+        return true;
+    }
+
     float getParam(const std::string& name) const override {
         if (name == "sigma") return sigma;
         if (name == "rho") return rho;
@@ -41,6 +53,14 @@ public:
         if (name == "beta") beta = value;
     }
 
+    std::vector<std::string> getParamNames() const override {
+        return {"sigma", "rho", "beta"};
+    }
+
+    std::unique_ptr<IteratedMap> clone() const override {
+        return std::make_unique<LorenzMap>(*this);
+    }
+
     const char* getName() const override {
         return "Lorenz Attractor";
     }
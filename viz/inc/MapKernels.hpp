@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+// Batched trajectory kernels of the built-in maps. The kernel bodies (MapKernelsImpl.hpp) are
+// compiled once per instruction set and the best variant the CPU supports is picked at startup;
+// the scalar variant is the maps' own iterate() loop. Every variant gives the same floats.
+enum KernelIsa { ISA_SCALAR, ISA_SSE2, ISA_AVX2, ISA_AVX512, ISA_COUNT };
+
+const char* isaName(int isa);
+// Compiled in, and supported by both the CPU and the OS
+bool isaSupported(int isa);
+int activeIsa();
+// Use another variant; false (keeping the current one) if it is not supported
+bool selectIsa(int isa);
+
+// Seeds traced together: the kernels keep their state in L1 and are vectorized across lanes
+constexpr int KERNEL_LANES = 64;
+
+// Seeds in, positions out: lane l's trajectory is (px, py, pz)[n * KERNEL_LANES + l] for
+// n = 0 (the seed) .. iterations, of which its first steps[l] are vertices (as in computeField:
+// up to and including the step that escapes). Lanes past `lanes` are traced but meaningless.
+// Ensembles give each lane its own value of one map parameter (variedParam, a getParamNames() index).
+struct TraceBatch {
+    int lanes = 0, iterations = 0;
+    float x[KERNEL_LANES], y[KERNEL_LANES], z[KERNEL_LANES];  // map space
+    int variedParam = -1;
+    float paramValues[KERNEL_LANES];
+    std::vector<float> px, py, pz;
+    int steps[KERNEL_LANES];
+
+    // Size the position arrays for `iterations` (keeps their capacity)
+    void reserve(int iterationCount);
+
+    // Per-lane values of parameter `param`: the map's `value`, or paramValues if it is the varied one
+    void laneParam(int param, float value, float* values) const {
+        for (int l = 0; l < KERNEL_LANES; l++) values[l] = param == variedParam ? paramValues[l] : value;
+    }
+};
+
+struct HenonParams {
+    float a[KERNEL_LANES], b[KERNEL_LANES];
+};
+
+struct LorenzParams {
+    float sigma[KERNEL_LANES], rho[KERNEL_LANES], beta[KERNEL_LANES];
+    float dt;
+    int substeps;
+};
+
+// What the variants see of a TraceBatch: raw pointers only, so no std inline function is
+// instantiated under instruction set flags (its weak copy could be the one the linker keeps
+// for every caller, including on CPUs without those instructions)
+struct TraceArrays {
+    int iterations;
+    const float *x, *y, *z;
+    float *px, *py, *pz;
+    int* steps;
+};
+
+// Trace a batch with the active variant
+void traceHenon(const HenonParams& params, TraceBatch& batch);
+void traceLorenz(const LorenzParams& params, TraceBatch& batch);
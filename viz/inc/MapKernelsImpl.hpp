@@ -0,0 +1,85 @@
+// Kernel bodies, included by one translation unit per instruction set (MapKernelsSse2.cpp, ...)
+// with KERNEL_VARIANT naming its namespace. They are written lane by lane over fixed-size arrays
+// for the compiler to vectorize, in the same operation order as HenonMap / LorenzMap::iterate
+// (and built with -ffp-contract=off) so every variant matches the scalar path exactly.
+// Only raw arrays and builtins here: nothing from the standard library (see TraceArrays).
+
+#include <cstddef>
+
+#include "MapKernels.hpp"
+
+namespace KERNEL_VARIANT {
+
+constexpr int L = KERNEL_LANES;
+
+static void storePositions(const TraceArrays& batch, int n, const float* x, const float* y, const float* z) {
+    float* px = batch.px + (size_t)n * L;
+    float* py = batch.py + (size_t)n * L;
+    float* pz = batch.pz + (size_t)n * L;
+    for (int l = 0; l < L; l++) {
+        px[l] = x[l];
+        py[l] = y[l];
+        pz[l] = z[l];
+    }
+}
+
+void traceHenon(const HenonParams& params, const TraceArrays& batch) {
+    float x[L], y[L], z[L];
+    int steps[L], alive[L];
+    for (int l = 0; l < L; l++) {
+        x[l] = batch.x[l];
+        y[l] = batch.y[l];
+        z[l] = batch.z[l];
+        steps[l] = 0;
+        alive[l] = 1;
+    }
+    for (int n = 0; n < batch.iterations; n++) {
+        storePositions(batch, n, x, y, z);
+        for (int l = 0; l < L; l++) {
+            float nx = params.a[l] - (y[l] * y[l]) - (params.b[l] * z[l]);
+            z[l] = y[l];
+            y[l] = x[l];
+            x[l] = nx;
+            // IteratedMap::hasEscaped
+            steps[l] += alive[l];
+            alive[l] &= !(__builtin_fabsf(nx) > 10.0f);
+        }
+    }
+    storePositions(batch, batch.iterations, x, y, z);
+    for (int l = 0; l < L; l++) batch.steps[l] = steps[l];
+}
+
+void traceLorenz(const LorenzParams& params, const TraceArrays& batch) {
+    const float dt = params.dt;
+    float x[L], y[L], z[L];
+    int steps[L], alive[L];
+    for (int l = 0; l < L; l++) {
+        x[l] = batch.x[l];
+        y[l] = batch.y[l];
+        z[l] = batch.z[l];
+        steps[l] = 0;
+        alive[l] = 1;
+    }
+    for (int n = 0; n < batch.iterations; n++) {
+        storePositions(batch, n, x, y, z);
+        for (int s = 0; s < params.substeps; s++) {
+            for (int l = 0; l < L; l++) {
+                float dx = params.sigma[l] * (y[l] - x[l]);
+                float dy = x[l] * (params.rho[l] - z[l]) - y[l];
+                float dz = x[l] * y[l] - params.beta[l] * z[l];
+                x[l] += dt * dx;
+                y[l] += dt * dy;
+                z[l] += dt * dz;
+            }
+        }
+        // LorenzMap::hasEscaped
+        for (int l = 0; l < L; l++) {
+            steps[l] += alive[l];
+            alive[l] &= !(x[l]*x[l] + y[l]*y[l] + z[l]*z[l] > 3000.0f);
+        }
+    }
+    storePositions(batch, batch.iterations, x, y, z);
+    for (int l = 0; l < L; l++) batch.steps[l] = steps[l];
+}
+
+}  // namespace KERNEL_VARIANT
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+// Hardware counters (perf_event_open) of the calling thread and of the threads it starts while
+// counting, wrapped around a kernel to read its IPC and cache / branch behaviour. Counters the
+// system does not provide (VMs, perf_event_paranoid > 2, non-Linux) are reported as unavailable
+// and everything else keeps working; wall time is always measured.
+class PerfCounters {
+public:
+    enum Counter { CYCLES, INSTRUCTIONS, CACHE_REFERENCES, CACHE_MISSES, BRANCHES, BRANCH_MISSES, COUNTER_COUNT };
+
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Count between start() and stop(); every start() resets the values
+    void start();
+    void stop();
+
+    bool available(Counter c) const { return fds[c] >= 0; }
+    bool anyAvailable() const;
+
+    // Of the last start() / stop() span, scaled up if the kernel multiplexed the counters
+    double seconds = 0;
+    double values[COUNTER_COUNT] = {};
+
+    // "IPC 2.10, 1.2 G cycles, 3.4% cache misses, 0.8% branch misses", or why counters are missing
+    std::string summary() const;
+
+private:
+    int fds[COUNTER_COUNT];
+    std::string error;  // why the first counter failed to open
+    long long startNs = 0;
+};
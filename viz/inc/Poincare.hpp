@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "IteratedMap.hpp"
+#include "Trajectories.hpp"
+
+// Plane axis = value (map space) crossed by a flow, and how long each seed is followed
+struct PoincareConfig {
+    int axis = 2;               // 0: x, 1: y, 2: z
+    float value = 27.0f;        // z = rho - 1 for the default Lorenz parameters
+    int size = 512;             // histogram cells per side
+    long long iterations = 100000;  // per seed, iterate() calls
+    int transient = 1000;       // leading iterations whose crossings are not counted
+};
+
+// Crossings of the plane (upwards only) on a size^2 grid over the two other axes in
+// (axis + 1, axis + 2) order, spanning [min, max]
+class PoincareHistogram {
+public:
+    int size = 0;
+    float min[2] = {0, 0}, max[2] = {0, 0};
+    std::vector<uint32_t> counts;
+
+    // RGB image (bottom row first) of log(1 + count), colormapped, empty cells black
+    void toImage(int colormap, std::vector<unsigned char>& rgb) const;
+};
+
+// Poincare section of the field's seeds, accumulated in the background: worker threads take
+// KERNEL_LANES seeds at a time, integrate them in short batches and only keep the plane
+// crossings, linearly interpolated between the two iterates on either side.
+class PoincareJob {
+public:
+    // The histogram bounds come from the crossings of a short preview over the first seeds, padded by 10%
+    PoincareJob(const IteratedMap& map, const FieldConfig& field, const PoincareConfig& config);
+    ~PoincareJob();
+
+    float progress() const { return blocks ? (float)blocksDone / blocks : 1.0f; }
+    bool done() const { return blocksDone == blocks; }
+    long long crossings() const { return crossingCount.load(std::memory_order_relaxed); }
+
+    // Snapshot of the counts so far
+    const PoincareHistogram& histogram();
+
+    const PoincareConfig config;
+
+private:
+    std::unique_ptr<IteratedMap> map;
+    std::vector<float> seeds;
+    PoincareHistogram snapshot;
+    std::unique_ptr<std::atomic<uint32_t>[]> counts;
+    int blocks = 0;
+    std::atomic<int> nextBlock{0}, blocksDone{0};
+    std::atomic<long long> crossingCount{0};
+    std::atomic<bool> cancelled{false};
+    std::vector<std::thread> workers;
+
+    void workerLoop();
+    // Point where segment p -> q (map space) crosses the plane upwards, on the two other axes
+    bool crossing(const float* p, const float* q, float& u, float& w) const;
+    void accumulate(float u, float w);
+};
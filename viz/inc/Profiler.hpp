@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Timing zones across threads, dumped as Chrome trace-event JSON (open in ui.perfetto.dev or
+// chrome://tracing). Always compiled in: while disabled a zone costs one relaxed atomic load, while
+// enabled two clock reads and one store into a buffer owned by the calling thread (no locks).
+class Profiler {
+public:
+    // Start recording; write() then dumps everything recorded so far to `path`
+    static void start(const std::string& path);
+    static bool enabled() { return recording.load(std::memory_order_relaxed); }
+
+    // Label of the calling thread in the trace (a string literal: it is kept by pointer); ignored,
+    // like zones, while not recording
+    static void setThreadName(const char* name);
+
+    // Nanoseconds on a monotonic clock
+    static uint64_t now();
+    static void record(const char* name, uint64_t start, uint64_t end);
+
+    // Write the trace if recording; false if the file could not be written
+    static bool write();
+
+private:
+    static std::atomic<bool> recording;
+};
+
+// Times its own lifetime as a zone named `name` (a string literal) on the calling thread
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* zoneName) : name(zoneName), active(Profiler::enabled()) {
+        if (active) start = Profiler::now();
+    }
+    ~ProfileZone() { end(); }
+
+    // Close the zone before the end of its scope
+    void end() {
+        if (active) Profiler::record(name, start, Profiler::now());
+        active = false;
+    }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    bool active;
+    uint64_t start = 0;
+};
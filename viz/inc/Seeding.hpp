@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+#include "IteratedMap.hpp"
+
+struct FieldConfig;
+class Trajectories;
+
+// How the seeds of a field are placed in its cube (center +- range)
+enum Sampling {
+    SAMPLING_LATTICE,   // regular resolution^3 grid (corners included)
+    SAMPLING_HALTON,    // Halton sequence, bases 2, 3, 5
+    SAMPLING_SOBOL,     // Sobol sequence (Joe-Kuo direction numbers)
+    SAMPLING_JITTERED,  // one random seed per cell of a k^3 grid (k^3 <= count), the rest uniform
+    SAMPLING_ADAPTIVE,  // resolution^3 lattice, cells whose corners end far apart split up to refineDepth times
+    SAMPLING_COUNT
+};
+
+const char* samplingName(int sampling);
+
+// Seed positions in visualization space, 3 floats each: resolution^3 for the lattice,
+// config.seedCount for the low-discrepancy strategies, at most config.refineBudget for adaptive
+// seeding, which traces the seeds to find where to refine. Deterministic for a given config and
+// map parameters. If traced is given, adaptive seeding appends the trajectories of its seeds (in
+// seed order, unsimplified) to it, so they need not be traced again; other strategies leave it as is.
+void generateSeeds(IteratedMap& map, const FieldConfig& config, std::vector<float>& xyz, Trajectories* traced = nullptr);
+
+// Print, for increasing seed counts, how much of the view the trajectories of every strategy cover
+// (share of a grid filled by their projections along the axes)
+void compareSampling(IteratedMap& map, const FieldConfig& config);
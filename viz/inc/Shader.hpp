@@ -0,0 +1,7 @@
+#pragma once
+
+#include <GL/gl.h>
+
+// Compile and link a vertex + fragment shader pair, returns 0 on failure (log printed to stderr)
+// attribs lists attribute names bound to locations 0, 1, ... before linking (nullptr-terminated)
+GLuint createProgram(const char* vertexSrc, const char* fragmentSrc, const char* const* attribs);
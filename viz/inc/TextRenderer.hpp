@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <initializer_list>
+
+#include <GLFW/glfw3.h>
+
+// HUD text drawn from a glyph atlas baked once from a GLUT bitmap font.
+// Text entries are positioned in pixels from the top-left corner, so the quad buffer
+// only depends on the strings and is rebuilt when one of them changes.
+class TextRenderer {
+public:
+    explicit TextRenderer(void* font);
+    ~TextRenderer();
+
+    // True if key differs from the one stored for entry id (and stores it): format the text only then
+    bool changed(int id, std::initializer_list<double> key);
+
+    // Set the text of entry id with its baseline at (x, y) pixels from the top-left corner
+    void setText(int id, float x, float y, const std::string& text);
+
+    void draw(int fbWidth, int fbHeight);
+
+private:
+    struct Entry {
+        float x = 0, y = 0;
+        std::string text;
+        std::vector<double> key;
+    };
+    std::vector<Entry> entries;
+    bool dirty = true;
+
+    // Atlas: glyph cells for characters FIRST_CHAR..LAST_CHAR
+    static constexpr int FIRST_CHAR = 32, LAST_CHAR = 126;
+    GLuint atlas = 0;
+    int atlasWidth = 512, atlasHeight = 0, cellHeight = 0, descent = 0;
+    int glyphX[LAST_CHAR - FIRST_CHAR + 1], glyphY[LAST_CHAR - FIRST_CHAR + 1], glyphAdvance[LAST_CHAR - FIRST_CHAR + 1];
+
+    GLuint vbo = 0;
+    int vertexCount = 0;
+
+    void bake(void* font);
+    void rebuild();
+    Entry& entry(int id);
+};
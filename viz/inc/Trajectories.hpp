@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "IteratedMap.hpp"
+#include "Arena.hpp"
+#include "Seeding.hpp"
+
+// One trajectory vertex in visualization space, with the step length used for coloring
+struct TrajectoryVertex {
+    float x, y, z;
+    float speed;
+};
+
+// Compact GPU copy of a TrajectoryVertex (8 bytes instead of 16): position quantized to 16 bits per
+// axis across the field bounds, speed to 8 bits as sqrt(speed / maxSpeed) (finer for slow segments)
+struct CompactVertex {
+    uint16_t x, y, z;
+    uint8_t speed, pad;
+};
+
+// Seed field description (what the user edits with the R/I/S/Ctrl keys)
+struct FieldConfig {
+    int resolution = 10, iterations = 15;
+    float range = 1.0f;
+    float cx = 0, cy = 0, cz = 0;
+
+    // Seed placement (see Seeding.hpp): resolution^3 lattice, seedCount seeds of a low-discrepancy
+    // strategy, or a resolution^3 lattice refined up to refineDepth times near separatrices, within
+    // refineBudget seeds
+    int sampling = 0;
+    int seedCount = 1000;
+    int refineDepth = 5, refineBudget = 40 * 40 * 40;
+
+    // Polyline simplification tolerance (visualization units, 0 = keep every vertex)
+    float simplify = 0.0f;
+
+    bool operator==(const FieldConfig& o) const {
+        return resolution == o.resolution && iterations == o.iterations && range == o.range
+            && cx == o.cx && cy == o.cy && cz == o.cz && simplify == o.simplify && sampling == o.sampling
+            && (sampling == SAMPLING_LATTICE || sampling == SAMPLING_ADAPTIVE || seedCount == o.seedCount)
+            && (sampling != SAMPLING_ADAPTIVE || (refineDepth == o.refineDepth && refineBudget == o.refineBudget));
+    }
+    bool operator!=(const FieldConfig& o) const { return !(*this == o); }
+};
+
+// Vertices per culling chunk (consecutive chunks share one vertex so strips stay connected)
+constexpr int CHUNK_VERTICES = 64;
+
+// Fixed-length piece of a line strip with its bounding box, the unit of frustum culling
+struct TrajectoryChunk {
+    int first, count;
+    float min[3], max[3];
+};
+
+// Decimated copy of every trajectory, keeping one vertex out of `stride` (and always the last one)
+struct LodLevel {
+    int stride = 1;
+    std::vector<int> firsts;
+    std::vector<int> counts;
+    std::vector<float> errors;  // per trajectory: max distance from a dropped vertex to its replacing segment
+    std::vector<TrajectoryChunk> chunks;
+    std::vector<int> chunkStarts;  // trajectory t owns chunks [chunkStarts[t], chunkStarts[t + 1])
+};
+
+// Computed field: all trajectories packed into one vertex array (one line strip each), trajectory t
+// (seed t of the lattice) being vertices [firsts[t], firsts[t] + counts[t]).
+// Recomputing into the same object reuses all of its storage: vertices live in a grow-only arena
+// and clear() keeps the capacity of every array, LOD levels included.
+class Trajectories {
+public:
+    ArenaVector<TrajectoryVertex> vertices;
+    std::vector<int> firsts;
+    std::vector<int> counts;
+    std::vector<LodLevel> lods;  // lods[0] is the full resolution, then stride 2, 4, 8, ... stored after it
+    float boundsMin[3] = {0, 0, 0}, boundsMax[3] = {0, 0, 0};
+    size_t computedVertices = 0, simplifiedVertices = 0;  // full resolution vertices before / after simplification
+
+    void clear();
+    int size() const { return (int)firsts.size(); }
+
+    // Vertex storage in use, and the most it ever held (what steady-state recomputes stay within)
+    size_t vertexBytes() const { return vertices.size() * sizeof(TrajectoryVertex); }
+    size_t highWaterBytes() const { return vertices.highWater() * sizeof(TrajectoryVertex); }
+};
+
+// Iterate every seed of the field and store the resulting trajectories
+void computeField(IteratedMap& map, const FieldConfig& config, Trajectories& out);
+
+// Trace count seeds (3 floats each, visualization space) with the map's kernels, appending one
+// unsimplified trajectory per seed to out. ends (3 floats per seed) receives where each seed ends
+// up after all iterations, NaN if it escaped.
+void traceField(IteratedMap& map, const float* seeds, size_t count, int iterations, Trajectories& out, float* ends);
+
+// Fields of several values of one map parameter (getParamNames() index `param`), one per value,
+// from the same seeds: each kernel lane carries its own parameter value. out[m] (values.size() of
+// them) are recomputed in place, reusing their storage.
+void computeEnsemble(IteratedMap& map, const FieldConfig& config, int param, const std::vector<float>& values,
+                     const std::vector<Trajectories*>& out);
+void computeEnsemble(IteratedMap& map, const FieldConfig& config, int param, const std::vector<float>& values,
+                     std::vector<Trajectories>& out);
+
+// Read a single orbit written by single_point_henon --points (float32 x y z, map space) as one
+// trajectory, divided by the map's scale. Longer orbits are read every k-th point, keeping at most
+// maxPoints (itself at most INT_MAX, the trajectory offsets being int).
+bool loadOrbit(const std::string& path, float scale, Trajectories& out, long long maxPoints);
+
+// Drop the vertices of every trajectory that stay within `tolerance` of the simplified strip and
+// whose speed the strip still interpolates to within one 8-bit step (Douglas-Peucker, in parallel
+// over trajectories). computeField applies it with config.simplify.
+void simplifyTrajectories(Trajectories& traj, float tolerance);
+
+// Build levels of detail (full resolution, then decimated until strides reach maxStride) and their culling chunks
+void buildLods(Trajectories& traj, int maxStride = 64);
+
+// Quantized vertices (all LOD levels, same indices as Trajectories::vertices) and how to decode them:
+// position = origin + q / 65535 * extent, speed = (s / 255)^2 * maxSpeed
+class CompactVertices {
+public:
+    ArenaVector<CompactVertex> vertices;
+    float origin[3] = {0, 0, 0}, extent[3] = {0, 0, 0};
+    float maxSpeed = 0;
+
+    // Quality loss measured while quantizing: max distance to the original position (world units)
+    // and max absolute speed error
+    float maxPositionError = 0, maxSpeedError = 0;
+};
+
+void quantizeVertices(const Trajectories& traj, CompactVertices& out);
+
+// Time every stage of a field computation (best of a few runs) with hardware counters, and print them
+void benchmarkField(IteratedMap& map, const FieldConfig& config);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <GLFW/glfw3.h>
 
@@ -8,19 +9,51 @@
 class Camera {
 public:
     float theta = 0.5f, phi = 1.2f, radius = 5.0f;
+    float fov = 45.0f, zNear = 0.1f, zFar = 100.0f;
     
     void update(GLFWwindow* window, bool ctrl);
     void apply();
+
+    // Eye position in world space
+    void eye(float& x, float& y, float& z) const;
+
+    // Screen pixels covered by one world unit at the given distance from the eye
+    float pixelsPerUnit(float distance, int viewportHeight) const;
 };
 
-// Render an infinite grid centered on camera position
-void drawInfiniteGrid(float camTheta, float camPhi, float camRadius);
+// View frustum planes (ax + by + cz + d >= 0 inside), extracted from the current GL matrices
+class Frustum {
+public:
+    float planes[6][4];
+
+    // Read GL_PROJECTION and GL_MODELVIEW, so it matches whatever gluPerspective/gluLookAt set up
+    void extract();
+
+    // Conservative test: false only if the box is fully outside one plane
+    bool intersects(const float min[3], const float max[3]) const;
+};
+
+// Static line geometry (GL_LINES pairs) kept in a vertex buffer, drawn with the current color and transform
+class LineMesh {
+public:
+    ~LineMesh();
 
-// Draw text at screen coordinates (0-1280, 0-720 in normalized space)
-void drawText(float x, float y, std::string text);
+    // xyz holds 3 floats per vertex
+    void upload(const std::vector<float>& xyz);
+    // Delete the buffer now (needs the GL context; the destructor then has nothing left to do)
+    void release();
+    void draw() const;
+    bool empty() const { return count == 0; }
 
-// Save framebuffer to PNG file in renders/ directory with timestamp
-void save_screenshot(GLFWwindow* window);
+private:
+    GLuint vbo = 0;
+    int count = 0;
+};
+
+// Render an infinite grid centered on camera position
+void drawInfiniteGrid(float camTheta, float camPhi, float camRadius);
+// Free the grid's vertex buffer, before the GL context is destroyed
+void releaseInfiniteGrid();
 
 // Print command-line usage instructions
 void printUsage(const char* progName);
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <sstream>
+
+#include "../inc/Animation.hpp"
+#include "../inc/Capture.hpp"
+#include "../inc/Profiler.hpp"
+
+bool AnimationScript::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        printf("Cannot open script %s\n", path.c_str());
+        return false;
+    }
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); lineNumber++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string directive;
+        if (!(words >> directive)) continue;
+
+        bool ok = true;
+        if (directive == "fps") {
+            ok = (words >> fps) && fps > 0;
+        } else if (directive == "size") {
+            ok = (words >> width >> height) && width > 0 && height > 0;
+        } else if (directive == "map") {
+            ok = (bool)(words >> map);
+        } else if (directive == "duration") {
+            ok = (words >> duration) && duration >= 0;
+        } else if (directive == "keyframe") {
+            double t;
+            ok = (words >> t) && t >= 0;
+            std::string assignment;
+            while (ok && words >> assignment) {
+                size_t eq = assignment.find('=');
+                ok = eq != std::string::npos && eq > 0;
+                if (!ok) break;
+                char* end;
+                std::string text = assignment.substr(eq + 1);
+                double value = strtod(text.c_str(), &end);
+                ok = !text.empty() && *end == '\0';
+                if (ok) tracks[assignment.substr(0, eq)].emplace_back(t, value);
+            }
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            printf("%s:%d: invalid line: %s\n", path.c_str(), lineNumber, line.c_str());
+            return false;
+        }
+    }
+
+    for (auto& [key, keyframes] : tracks) {
+        std::stable_sort(keyframes.begin(), keyframes.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+    }
+    return true;
+}
+
+int AnimationScript::frameCount() const {
+    double end = duration;
+    if (end < 0) {
+        end = 0;
+        for (const auto& [key, keyframes] : tracks) end = std::max(end, keyframes.back().first);
+    }
+    return (int)std::floor(end * fps + 1e-6) + 1;
+}
+
+// Linear interpolation between the surrounding keyframes, holding the first/last value outside them
+static double sampleTrack(const std::vector<std::pair<double, double>>& keyframes, double t) {
+    if (t <= keyframes.front().first) return keyframes.front().second;
+    if (t >= keyframes.back().first) return keyframes.back().second;
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), t,
+                                 [](double time, const auto& k) { return time < k.first; });
+    auto prev = next - 1;
+    double f = (t - prev->first) / (next->first - prev->first);
+    return prev->second + (next->second - prev->second) * f;
+}
+
+void AnimationScript::apply(double t, Camera& cam, FieldVisualizer& field) const {
+    for (const auto& [key, keyframes] : tracks) {
+        double v = sampleTrack(keyframes, t);
+        if (key == "theta") cam.theta = (float)v;
+        else if (key == "phi") cam.phi = (float)v;
+        else if (key == "radius") cam.radius = (float)v;
+        else if (key == "cx") field.cx = (float)v;
+        else if (key == "cy") field.cy = (float)v;
+        else if (key == "cz") field.cz = (float)v;
+        else if (key == "range") field.range = (float)v;
+        else if (key == "resolution") field.resolution = std::max(1, (int)std::lround(v));
+        else if (key == "iterations") field.iterations = std::max(1, (int)std::lround(v));
+        else if (key == "seeds") field.seedCount = std::max(1, (int)std::lround(v));
+        else field.map->setParam(key, (float)v);
+    }
+}
+
+// Everything the trajectories depend on: field config followed by the map parameters
+static std::vector<float> fieldKey(const FieldVisualizer& field) {
+    FieldConfig c = field.config();
+    std::vector<float> key = {(float)c.resolution, (float)c.iterations, c.range, c.cx, c.cy, c.cz,
+                              (float)c.sampling, (float)c.seedCount};
+    std::vector<float> params = field.params();
+    key.insert(key.end(), params.begin(), params.end());
+    return key;
+}
+
+// Trajectories for one distinct field key, computed in the background on a copy of the map
+struct FieldJob {
+    FieldConfig config;
+    std::vector<float> params;
+    int lastUse = 0;  // last frame switching to this field, its trajectories can be moved there
+    bool launched = false;
+    std::future<Trajectories> pending;
+    Trajectories result;
+};
+
+bool renderAnimation(const AnimationScript& script, Camera& cam, FieldVisualizer& field, const std::string& outDir) {
+    std::vector<std::string> paramNames = field.map->getParamNames();
+    for (const auto& [key, keyframes] : script.tracks) {
+        static const char* builtin[] = {"theta", "phi", "radius", "cx", "cy", "cz", "range", "resolution", "iterations", "seeds"};
+        bool known = std::find(std::begin(builtin), std::end(builtin), key) != std::end(builtin)
+                  || std::find(paramNames.begin(), paramNames.end(), key) != paramNames.end();
+        if (!known) printf("Warning: %s has no parameter '%s', ignored\n", field.map->getName(), key.c_str());
+    }
+
+    // Plan: field key of every frame, and one job per distinct key in order of first use.
+    // Consecutive frames with the same key reuse the trajectories already uploaded.
+    int frames = script.frameCount();
+    std::vector<std::vector<float>> frameKeys(frames);
+    std::map<std::vector<float>, FieldJob> jobs;
+    std::vector<std::vector<float>> order;
+    for (int f = 0; f < frames; f++) {
+        script.apply(script.frameTime(f), cam, field);
+        frameKeys[f] = fieldKey(field);
+        if (f > 0 && frameKeys[f] == frameKeys[f - 1]) continue;
+        auto [it, inserted] = jobs.try_emplace(frameKeys[f]);
+        if (inserted) {
+            it->second.config = field.config();
+            it->second.params = field.params();
+            order.push_back(frameKeys[f]);
+        }
+        it->second.lastUse = f;
+    }
+
+    auto launch = [&](FieldJob& job) {
+        std::unique_ptr<IteratedMap> map = field.map->clone();
+        for (size_t i = 0; i < paramNames.size(); i++) map->setParam(paramNames[i], job.params[i]);
+        job.pending = std::async(std::launch::async, [](std::unique_ptr<IteratedMap> m, FieldConfig config) {
+            Profiler::setThreadName("field job");
+            Trajectories traj;
+            computeField(*m, config, traj);
+            buildLods(traj);
+            return traj;
+        }, std::move(map), job.config);
+        job.launched = true;
+    };
+
+    // Fields are computed ahead of rendering, one per hardware thread held at a time
+    // (at least two, so the next field is computed while the current one is rendered)
+    size_t window = std::max(2u, std::thread::hardware_concurrency());
+    size_t nextJob = 0, held = 0;
+
+    OffscreenBuffer target(script.width, script.height);
+    if (!target.valid()) {
+        printf("Cannot create a %dx%d offscreen framebuffer\n", script.width, script.height);
+        return false;
+    }
+    FrameRecorder recorder(FrameRecorder::PNG, outDir, script.fps);
+    recorder.dropFrames = false;
+    if (!recorder.start(script.width, script.height)) return false;
+
+    printf("Rendering %d frames (%d distinct fields) at %dx%d, %d fps\n",
+           frames, (int)order.size(), script.width, script.height, script.fps);
+    auto start = std::chrono::steady_clock::now();
+    target.bind();
+    for (int f = 0; f < frames; f++) {
+        // The field of this frame is always launched, even when the window is full of fields reused later
+        auto current = jobs.find(frameKeys[f]);
+        bool needed = current != jobs.end() && !current->second.launched;
+        while (nextJob < order.size() && (held < window || needed)) {
+            launch(jobs[order[nextJob++]]);
+            held++;
+            needed = needed && !current->second.launched;
+        }
+
+        script.apply(script.frameTime(f), cam, field);
+        if (f == 0 || frameKeys[f] != frameKeys[f - 1]) {
+            FieldJob& job = jobs[frameKeys[f]];
+            ProfileZone zone("wait field");
+            if (job.pending.valid()) job.result = job.pending.get();
+            if (f == job.lastUse) {
+                field.adopt(std::move(job.result));
+                jobs.erase(frameKeys[f]);
+                held--;
+            } else {
+                field.adopt(job.result);
+            }
+        }
+
+        {
+            ProfileZone zone("draw");
+            renderScene(cam, field, script.width, script.height);
+        }
+        {
+            ProfileZone zone("capture");
+            recorder.frame(script.width, script.height);
+            recorder.poll();
+        }
+        printf("\rFrame %d/%d", f + 1, frames);
+        fflush(stdout);
+    }
+    target.unbind();
+    printf("\n");
+    recorder.stop();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Rendered %d frames in %.2f s (%.1f frames/s)\n", frames, seconds, frames / seconds);
+    return true;
+}
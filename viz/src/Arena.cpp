@@ -0,0 +1,33 @@
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../inc/Arena.hpp"
+
+bool Arena::hugePages = false;
+
+static const size_t HUGE_PAGE = 2 << 20;
+
+Arena::~Arena() {
+    if (base) munmap(base, reserved);
+}
+
+bool Arena::reserve(size_t bytes) {
+    if (bytes <= reserved) return true;
+
+    // Grow geometrically, in whole (huge) pages
+    size_t page = hugePages ? HUGE_PAGE : (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = std::max(bytes, reserved + reserved / 2);
+    size = (size + page - 1) / page * page;
+
+    void* block = base ? mremap(base, reserved, size, MREMAP_MAYMOVE)
+                       : mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED) return false;
+#ifdef MADV_HUGEPAGE
+    if (hugePages) madvise(block, size, MADV_HUGEPAGE);
+#endif
+    base = block;
+    reserved = size;
+    return true;
+}
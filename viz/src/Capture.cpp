@@ -0,0 +1,482 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+
+#include "../inc/Capture.hpp"
+#include "../inc/ImageEncoders.hpp"
+#include "../inc/Profiler.hpp"
+
+AsyncCapture::AsyncCapture(int slotCount, int workerCount) : slots(slotCount) {
+    for (Slot& slot : slots) glGenBuffers(1, &slot.pbo);
+    for (int i = 0; i < workerCount; i++) workers.emplace_back(&AsyncCapture::workerLoop, this);
+}
+
+AsyncCapture::~AsyncCapture() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : workers) t.join();
+    for (Slot& slot : slots) {
+        if (slot.fence) glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.pbo);
+    }
+}
+
+bool AsyncCapture::capture(int width, int height, FrameEncoder encode) {
+    for (Slot& slot : slots) {
+        if (slot.state != FREE) continue;
+        size_t size = (size_t)width * height * 3;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        if (slot.size != size) {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+            slot.size = size;
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.width = width;
+        slot.height = height;
+        slot.encode = std::move(encode);
+        slot.ticket = nextTicket++;
+        slot.state = READING;
+        return true;
+    }
+    return false;
+}
+
+void AsyncCapture::poll() {
+    // Hand readbacks to workers strictly in capture order, stopping at the first one not finished yet
+    // (a readback not finished is picked up next frame, we never wait here)
+    std::vector<Slot*> reading;
+    for (Slot& slot : slots) if (slot.state == READING) reading.push_back(&slot);
+    std::sort(reading.begin(), reading.end(), [](Slot* a, Slot* b) { return a->ticket < b->ticket; });
+    for (Slot* slot : reading) {
+        GLenum status = glClientWaitSync(slot->fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(slot->fence);
+        slot->fence = 0;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+        slot->mapped = (const unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot->state = ENCODING;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(slot);
+        }
+        wake.notify_one();
+    }
+
+    for (Slot& slot : slots) {
+        if (slot.state != ENCODED) continue;
+        if (slot.mapped) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        slot.mapped = nullptr;
+        slot.encode = nullptr;
+        slot.state = FREE;
+    }
+}
+
+void AsyncCapture::finish() {
+    for (;;) {
+        poll();
+        bool idle = true;
+        for (Slot& slot : slots) idle = idle && slot.state == FREE;
+        if (idle) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void AsyncCapture::workerLoop() {
+    Profiler::setThreadName("capture");
+    for (;;) {
+        Slot* slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return;
+            slot = jobs.front();
+            jobs.pop_front();
+        }
+        {
+            ProfileZone zone("encode");
+            slot->encode(slot->mapped, slot->width, slot->height);
+        }
+        slot->state = ENCODED;
+    }
+}
+
+OffscreenBuffer::OffscreenBuffer(int width, int height) : width(width), height(height) {
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &color);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+OffscreenBuffer::~OffscreenBuffer() {
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &color);
+    glDeleteRenderbuffers(1, &depth);
+}
+
+void OffscreenBuffer::bind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+void OffscreenBuffer::unbind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static std::string timestamp(const char* format) {
+    time_t now = time(0);
+    char buf[100];
+    strftime(buf, sizeof(buf), format, localtime(&now));
+    return buf;
+}
+
+std::string screenshotPath(const std::string& suffix) {
+    return timestamp("renders/flow_map_%Y%m%d_%H%M%S") + suffix + ".png";
+}
+
+bool writePng(const std::string& path, const unsigned char* pixels, int width, int height, int level, int threads) {
+    thread_local std::vector<unsigned char> encoded;
+    return encodePng(pixels, width, height, encoded, level, threads) && writeFile(path, encoded);
+}
+
+bool writeQoi(const std::string& path, const unsigned char* pixels, int width, int height) {
+    thread_local std::vector<unsigned char> encoded;
+    encodeQoi(pixels, width, height, encoded);
+    return writeFile(path, encoded);
+}
+
+bool writePpm(const std::string& path, const unsigned char* pixels, int width, int height) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    fprintf(f, "P6\n%d %d\n255\n", width, height);
+    size_t stride = (size_t)width * 3;
+    bool ok = true;
+    for (int row = height - 1; row >= 0 && ok; row--) ok = fwrite(pixels + row * stride, 1, stride, f) == stride;
+    return fclose(f) == 0 && ok;
+}
+
+PngStream::~PngStream() {
+    if (file) close();
+}
+
+static void putBigEndian(unsigned char* p, uint32_t v) {
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+void PngStream::chunk(const char* type, const unsigned char* data, size_t size) {
+    unsigned char header[8];
+    putBigEndian(header, (uint32_t)size);
+    memcpy(header + 4, type, 4);
+    uLong crc = crc32(0, header + 4, 4);
+    if (size) crc = crc32(crc, data, (uInt)size);
+    unsigned char footer[4];
+    putBigEndian(footer, (uint32_t)crc);
+    ok = ok && fwrite(header, 1, 8, file) == 8 && (!size || fwrite(data, 1, size, file) == size)
+            && fwrite(footer, 1, 4, file) == 4;
+}
+
+// Run deflate over the pending input, emitting an IDAT chunk each time the output buffer fills up
+void PngStream::deflateInput(int flush) {
+    for (;;) {
+        zs.next_out = compressed.data();
+        zs.avail_out = (uInt)compressed.size();
+        int status = deflate(&zs, flush);
+        size_t produced = compressed.size() - zs.avail_out;
+        if (produced) chunk("IDAT", compressed.data(), produced);
+        if (status == Z_STREAM_END || (zs.avail_out != 0 && zs.avail_in == 0)) return;
+        if (status != Z_OK && status != Z_BUF_ERROR) {
+            ok = false;
+            return;
+        }
+    }
+}
+
+bool PngStream::open(const std::string& path, int w, int h) {
+    file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    width = w;
+    height = h;
+    rows = 0;
+    ok = deflateInit(&zs, Z_DEFAULT_COMPRESSION) == Z_OK;
+    filtered.resize((size_t)w * 3 + 1);
+    compressed.resize(1 << 20);
+
+    static const unsigned char signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+    ok = ok && fwrite(signature, 1, 8, file) == 8;
+    unsigned char ihdr[13];
+    putBigEndian(ihdr, w);
+    putBigEndian(ihdr + 4, h);
+    ihdr[8] = 8;    // bits per channel
+    ihdr[9] = 2;    // RGB
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;  // deflate, adaptive filtering, no interlace
+    chunk("IHDR", ihdr, sizeof(ihdr));
+    return ok;
+}
+
+bool PngStream::writeRow(const unsigned char* rgb) {
+    if (!ok || rows == height) return ok = false;
+    // "Sub" filter: each byte minus the same channel of the previous pixel
+    filtered[0] = 1;
+    size_t stride = (size_t)width * 3;
+    for (size_t i = 0; i < stride; i++) filtered[i + 1] = (unsigned char)(rgb[i] - (i >= 3 ? rgb[i - 3] : 0));
+    zs.next_in = filtered.data();
+    zs.avail_in = (uInt)filtered.size();
+    deflateInput(Z_NO_FLUSH);
+    rows++;
+    return ok;
+}
+
+bool PngStream::close() {
+    if (!file) return false;
+    ok = ok && rows == height;
+    if (ok) deflateInput(Z_FINISH);
+    deflateEnd(&zs);
+    if (ok) chunk("IEND", nullptr, 0);
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+bool captureTiled(Camera& cam, FieldVisualizer& field, int width, int height, int scale, int samples,
+                  const std::string& path) {
+    OffscreenBuffer tileBuffer(width * samples, height * samples);
+    if (!tileBuffer.valid()) {
+        printf("Cannot create a %dx%d offscreen framebuffer\n", width * samples, height * samples);
+        return false;
+    }
+    PngStream png;
+    if (!png.open(path, width * scale, height * scale)) {
+        printf("Cannot write %s\n", path.c_str());
+        return false;
+    }
+
+    std::vector<unsigned char> tile((size_t)tileBuffer.width * tileBuffer.height * 3);
+    std::vector<unsigned char> band((size_t)width * scale * height * 3);
+    size_t bandStride = (size_t)width * scale * 3;
+    float sampleWeight = 1.0f / (samples * samples);
+
+    // Supersampled lines would otherwise get thinner (and fainter once filtered)
+    glPushAttrib(GL_LINE_BIT);
+    glLineWidth((float)samples);
+    tileBuffer.bind();
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    // PNG rows go top to bottom: start with the top row of tiles
+    for (int row = scale - 1; row >= 0; row--) {
+        for (int column = 0; column < scale; column++) {
+            ViewTile view;
+            view.column = column;
+            view.row = row;
+            view.columns = view.rows = scale;
+            renderScene(cam, field, tileBuffer.width, tileBuffer.height, view);
+            glReadPixels(0, 0, tileBuffer.width, tileBuffer.height, GL_RGB, GL_UNSIGNED_BYTE, tile.data());
+
+            // Box filter samples x samples blocks into the band, flipping rows
+            for (int y = 0; y < height; y++) {
+                unsigned char* dst = band.data() + (size_t)(height - 1 - y) * bandStride + (size_t)column * width * 3;
+                for (int x = 0; x < width; x++) {
+                    float sum[3] = {0, 0, 0};
+                    for (int sy = 0; sy < samples; sy++) {
+                        const unsigned char* src = tile.data() + ((size_t)(y * samples + sy) * tileBuffer.width + x * samples) * 3;
+                        for (int sx = 0; sx < samples; sx++, src += 3) {
+                            sum[0] += src[0]; sum[1] += src[1]; sum[2] += src[2];
+                        }
+                    }
+                    for (int c = 0; c < 3; c++) dst[x * 3 + c] = (unsigned char)(sum[c] * sampleWeight + 0.5f);
+                }
+            }
+        }
+        for (int y = 0; y < height; y++) png.writeRow(band.data() + (size_t)y * bandStride);
+        printf("\rHigh resolution capture: %d%%", 100 * (scale - row) / scale);
+        fflush(stdout);
+    }
+    tileBuffer.unbind();
+    glPopAttrib();
+    printf("\n");
+
+    bool ok = png.close();
+    if (ok) printf("Screenshot saved: %s (%dx%d)\n", path.c_str(), width * scale, height * scale);
+    else printf("Failed to write %s\n", path.c_str());
+    return ok;
+}
+
+bool parseRecordFormat(const std::string& name, FrameRecorder::Format& format) {
+    if (name == "png") format = FrameRecorder::PNG;
+    else if (name == "png-fast") format = FrameRecorder::PNG_FAST;
+    else if (name == "png-store") format = FrameRecorder::PNG_STORE;
+    else if (name == "qoi") format = FrameRecorder::QOI;
+    else if (name == "ppm") format = FrameRecorder::PPM;
+    else if (name == "y4m") format = FrameRecorder::Y4M;
+    else return false;
+    return true;
+}
+
+static int recorderWorkers() {
+    unsigned hw = std::thread::hardware_concurrency();
+    return (int)std::clamp(hw > 1 ? hw - 1 : 1u, 1u, 4u);
+}
+
+FrameRecorder::FrameRecorder(Format format, std::string output, int fps)
+    : format(format), output(std::move(output)), fps(fps), capture(8, recorderWorkers()) {}
+
+FrameRecorder::~FrameRecorder() {
+    if (active) stop();
+}
+
+bool FrameRecorder::start(int w, int h) {
+    target = output;
+    if (target.empty()) target = timestamp("renders/rec_%Y%m%d_%H%M%S") + (format == Y4M ? ".y4m" : "");
+
+    if (format == Y4M) {
+        pipe = target[0] == '|';
+        if (pipe) {
+            // A consumer exiting early must not kill us with SIGPIPE
+            signal(SIGPIPE, SIG_IGN);
+            stream = popen(target.c_str() + 1, "w");
+        } else {
+            stream = fopen(target.c_str(), "wb");
+        }
+        if (!stream) {
+            printf("Recording failed: cannot open %s\n", target.c_str());
+            return false;
+        }
+        if (fprintf(stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", w, h, fps) < 0) {
+            printf("Recording failed: cannot write to %s\n", target.c_str());
+            if (pipe) pclose(stream); else fclose(stream);
+            stream = nullptr;
+            return false;
+        }
+    } else {
+        std::error_code ec;
+        std::filesystem::create_directories(target, ec);
+        if (ec) {
+            printf("Recording failed: cannot create %s\n", target.c_str());
+            return false;
+        }
+    }
+
+    width = w;
+    height = h;
+    recorded = dropped = 0;
+    nextWrite = 0;
+    streamFailed = false;
+    failed = 0;
+    active = true;
+    printf("Recording to %s\n", target.c_str());
+    return true;
+}
+
+void FrameRecorder::stop() {
+    if (!active) return;
+    capture.finish();
+    if (stream) {
+        if (pipe) pclose(stream); else fclose(stream);
+        stream = nullptr;
+    }
+    active = false;
+    printf("Recording stopped: %lld frames, %lld dropped, %lld failed -> %s\n", recorded, dropped, failed.load(),
+           target.c_str());
+}
+
+void FrameRecorder::frame(int w, int h) {
+    if (!active) return;
+    if (w != width || h != height) {
+        printf("Framebuffer resized while recording, stopping.\n");
+        stop();
+        return;
+    }
+    if (streamFailed) {
+        printf("Cannot write to %s anymore, stopping.\n", target.c_str());
+        stop();
+        return;
+    }
+    long long index = recorded;
+    auto job = [this, index](const unsigned char* pixels, int pw, int ph) { encode(index, pixels, pw, ph); };
+    bool queued = capture.capture(w, h, job);
+    while (!queued && !dropFrames) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        capture.poll();
+        queued = capture.capture(w, h, job);
+    }
+    if (queued) recorded++; else dropped++;
+}
+
+void FrameRecorder::poll() {
+    capture.poll();
+}
+
+void FrameRecorder::encode(long long index, const unsigned char* pixels, int w, int h) {
+    if (!pixels) {
+        printf("Failed to read back frame %lld\n", index);
+        failed++;
+    }
+    if (format != Y4M) {
+        if (!pixels) return;
+        // Frames are already encoded concurrently, one per worker: single-threaded PNG bands
+        char name[32];
+        snprintf(name, sizeof(name), "/frame_%06lld.%s", index, format == PPM ? "ppm" : format == QOI ? "qoi" : "png");
+        bool ok;
+        if (format == PPM) ok = writePpm(target + name, pixels, w, h);
+        else if (format == QOI) ok = writeQoi(target + name, pixels, w, h);
+        else ok = writePng(target + name, pixels, w, h, format == PNG ? 6 : format == PNG_FAST ? 1 : 0, 1);
+        if (!ok) {
+            printf("Failed to write frame %lld\n", index);
+            failed++;
+        }
+        return;
+    }
+
+    // RGB -> planar YUV 4:4:4 (BT.601 limited range), flipping rows; buffers reused per worker
+    thread_local std::vector<unsigned char> yuv;
+    size_t plane = (size_t)w * h;
+    yuv.resize(plane * 3);
+    for (int row = 0; row < h && pixels; row++) {
+        const unsigned char* src = pixels + (size_t)(h - 1 - row) * w * 3;
+        size_t o = (size_t)row * w;
+        for (int x = 0; x < w; x++, src += 3, o++) {
+            int r = src[0], g = src[1], b = src[2];
+            yuv[o] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            yuv[plane + o] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            yuv[2 * plane + o] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(writeMutex);
+    writeTurn.wait(lock, [&] { return nextWrite == index; });
+    // Every index takes its turn, written or not, so the following frames are never blocked
+    if (pixels && !streamFailed) {
+        bool ok = fputs("FRAME\n", stream) >= 0 && fwrite(yuv.data(), 1, yuv.size(), stream) == yuv.size();
+        if (!ok) {
+            streamFailed = true;
+            failed++;
+        }
+    } else if (pixels) {
+        failed++;
+    }
+    nextWrite++;
+    lock.unlock();
+    writeTurn.notify_all();
+}
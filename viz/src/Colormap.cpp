@@ -0,0 +1,100 @@
+#include <algorithm>
+
+#include "../inc/Colormap.hpp"
+
+struct Rgb { float r, g, b; };
+
+// Original look: red for slow steps, blue for fast ones
+static Rgb classic(float t) {
+    return {1.0f - t, 0.2f, t};
+}
+
+// 6th degree polynomial fits of the matplotlib colormaps
+static Rgb polynomial(const float c[7][3], float t) {
+    Rgb out;
+    float* dst[3] = {&out.r, &out.g, &out.b};
+    for (int ch = 0; ch < 3; ch++) {
+        float v = c[6][ch];
+        for (int i = 5; i >= 0; i--) v = v * t + c[i][ch];
+        *dst[ch] = v;
+    }
+    return out;
+}
+
+static const float VIRIDIS[7][3] = {
+    {0.2777273272f, 0.0054073445f, 0.3340998053f},
+    {0.1050930431f, 1.4046135299f, 1.3845901626f},
+    {-0.3308618287f, 0.2148475595f, 0.0950951630f},
+    {-4.6342304990f, -5.7991009734f, -19.3324409563f},
+    {6.2282699363f, 14.1799333668f, 56.6905526007f},
+    {4.7763849977f, -13.7451453777f, -65.3530326334f},
+    {-5.4354558559f, 4.6458526122f, 26.3124352496f},
+};
+
+static const float PLASMA[7][3] = {
+    {0.0587323439f, 0.0233367089f, 0.5433401827f},
+    {2.1765146342f, 0.2383834171f, 0.7539604600f},
+    {-2.6894604765f, -7.4558511357f, 3.1107999397f},
+    {6.1303483459f, 42.3461881477f, -28.5188546533f},
+    {-11.1074361906f, -82.6663110943f, 60.1398476742f},
+    {10.0230655765f, 71.4136177010f, -54.0721865556f},
+    {-3.6587138428f, -22.9315346546f, 18.1919077854f},
+};
+
+static const float MAGMA[7][3] = {
+    {-0.0021364851f, -0.0007496551f, -0.0053861279f},
+    {0.2516605407f, 0.6775232437f, 2.4940265993f},
+    {8.3537172792f, -3.5777195150f, 0.3144679030f},
+    {-27.6687330858f, 14.2647307810f, -13.6492131881f},
+    {52.1761398123f, -27.9436060717f, 12.9441694424f},
+    {-50.7685253647f, 29.0465828213f, 4.2341529938f},
+    {18.6557050659f, -11.4897735200f, -5.6019615087f},
+};
+
+static const float INFERNO[7][3] = {
+    {0.0002189404f, 0.0016510046f, -0.0194808984f},
+    {0.1065134195f, 0.5639564368f, 3.9327123889f},
+    {11.6024930825f, -3.9728539657f, -15.9423941063f},
+    {-41.7039961314f, 17.4363988821f, 44.3541451987f},
+    {77.1629356994f, -33.4023589421f, -81.8073092574f},
+    {-71.3194282450f, 32.6260642640f, 73.2095198580f},
+    {25.1311262248f, -12.2426689524f, -23.0703250029f},
+};
+
+// Polynomial approximation of Google's Turbo
+static Rgb turbo(float t) {
+    return {
+        0.13572138f + t*(4.61539260f + t*(-42.66032258f + t*(132.13108234f + t*(-152.94239396f + t*59.28637943f)))),
+        0.09140261f + t*(2.19418839f + t*(4.84296658f + t*(-14.18503333f + t*(4.27729857f + t*2.82956604f)))),
+        0.10667330f + t*(12.64194608f + t*(-60.58204836f + t*(110.36276771f + t*(-89.90310912f + t*27.34824973f)))),
+    };
+}
+
+static const char* NAMES[] = {"Classic", "Viridis", "Plasma", "Magma", "Inferno", "Turbo"};
+
+int colormapCount() {
+    return (int)(sizeof(NAMES) / sizeof(NAMES[0]));
+}
+
+const char* colormapName(int idx) {
+    return NAMES[std::clamp(idx, 0, colormapCount() - 1)];
+}
+
+void buildColormap(int idx, std::vector<unsigned char>& rgb) {
+    rgb.resize(COLORMAP_SIZE * 3);
+    for (int i = 0; i < COLORMAP_SIZE; i++) {
+        float t = (float)i / (float)(COLORMAP_SIZE - 1);
+        Rgb c;
+        switch (idx) {
+            case 1: c = polynomial(VIRIDIS, t); break;
+            case 2: c = polynomial(PLASMA, t); break;
+            case 3: c = polynomial(MAGMA, t); break;
+            case 4: c = polynomial(INFERNO, t); break;
+            case 5: c = turbo(t); break;
+            default: c = classic(t); break;
+        }
+        rgb[i * 3 + 0] = (unsigned char)(std::clamp(c.r, 0.0f, 1.0f) * 255.0f + 0.5f);
+        rgb[i * 3 + 1] = (unsigned char)(std::clamp(c.g, 0.0f, 1.0f) * 255.0f + 0.5f);
+        rgb[i * 3 + 2] = (unsigned char)(std::clamp(c.b, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+}
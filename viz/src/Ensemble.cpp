@@ -0,0 +1,114 @@
+#include <cmath>
+#include <chrono>
+
+#include "../inc/Ensemble.hpp"
+
+float Ensemble::value(const FieldVisualizer& field, int m) const {
+    float base = field.map->getParam(paramName(field));
+    if (members < 2) return base;
+    return base * (1.0f + spread * (2.0f * m / (members - 1) - 1.0f));
+}
+
+const std::string& Ensemble::paramName(const FieldVisualizer& field) const {
+    const std::vector<std::string>& names = field.paramNames();
+    return names[param % names.size()];
+}
+
+int Ensemble::columns() const {
+    return (int)std::ceil(std::sqrt((double)members));
+}
+
+int Ensemble::rows() const {
+    return (members + columns() - 1) / columns();
+}
+
+void Ensemble::viewport(int m, int width, int height, int& x, int& y, int& w, int& h) const {
+    // Row-major from the top-left, like the HUD
+    w = width / columns();
+    h = height / rows();
+    x = (m % columns()) * w;
+    y = height - (m / columns() + 1) * h;
+}
+
+void Ensemble::follow(const FieldVisualizer& field) {
+    while ((int)fields.size() < members) fields.push_back(std::make_unique<FieldVisualizer>(field.map->clone()));
+    fields.resize(members);
+    const std::vector<std::string>& names = field.paramNames();
+    for (int m = 0; m < members; m++) {
+        FieldVisualizer& member = *fields[m];
+        member.resolution = field.resolution;
+        member.iterations = field.iterations;
+        member.range = field.range;
+        member.cx = field.cx; member.cy = field.cy; member.cz = field.cz;
+        member.sampling = field.sampling;
+        member.seedCount = field.seedCount;
+        member.refineDepth = field.refineDepth;
+        member.refineBudget = field.refineBudget;
+        member.simplify = field.simplify;
+        member.colormap = field.colormap;
+        member.speedScale = field.speedScale;
+        member.lodErrorPx = field.lodErrorPx;
+        member.compact = field.compact;
+        member.points = field.points;
+        member.pointSize = field.pointSize;
+        member.pointAlpha = field.pointAlpha;
+        for (const std::string& name : names) member.map->setParam(name, field.map->getParam(name));
+        member.map->setParam(paramName(field), value(field, m));
+    }
+}
+
+void Ensemble::render(Camera& cam, FieldVisualizer& field, int width, int height) {
+    follow(field);
+
+    bool stale = false;
+    for (const auto& member : fields) stale |= member->stale();
+    if (stale) {
+        // All members at once, into their own storage, then their LODs
+        auto start = std::chrono::steady_clock::now();
+        values.clear();
+        targets.clear();
+        for (int m = 0; m < members; m++) {
+            values.push_back(value(field, m));
+            targets.push_back(&fields[m]->fieldStorage());
+        }
+        computeEnsemble(*field.map, field.config(), param % (int)field.paramNames().size(), values, targets);
+        for (int m = 0; m < members; m++) {
+            buildLods(*targets[m]);
+            fields[m]->adoptInPlace();
+        }
+        computeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    glClearColor(0, 0, 0, 1);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    for (int m = 0; m < members; m++) {
+        int x, y, w, h;
+        viewport(m, width, height, x, y, w, h);
+        renderView(cam, *fields[m], x, y, w, h);
+    }
+    glViewport(0, 0, width, height);
+}
+
+long long Ensemble::drawnVertices() const {
+    long long total = 0;
+    for (const auto& member : fields) total += member->drawnVertices;
+    return total;
+}
+
+long long Ensemble::fieldVertices() const {
+    long long total = 0;
+    for (const auto& member : fields) total += member->fieldVertices;
+    return total;
+}
+
+int Ensemble::drawnChunks() const {
+    int total = 0;
+    for (const auto& member : fields) total += member->drawnChunks;
+    return total;
+}
+
+int Ensemble::culledChunks() const {
+    int total = 0;
+    for (const auto& member : fields) total += member->culledChunks;
+    return total;
+}
@@ -0,0 +1,278 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../inc/FieldCache.hpp"
+#include "../inc/Profiler.hpp"
+
+namespace fs = std::filesystem;
+
+static const uint32_t CACHE_MAGIC = 0x44464345;  // "ECFD"
+// Bump when the file layout or anything a field's vertices depend on changes
+static const uint32_t CACHE_VERSION = 1;
+
+// File layout: this header, the description, then arrays of int / float / TrajectoryVertex /
+// TrajectoryChunk (all 4-byte aligned): vertices, firsts, counts, and per LOD level its stride,
+// chunk count, firsts, counts, errors, chunkStarts and chunks
+struct CacheHeader {
+    uint32_t magic, version;
+    uint32_t descriptionBytes, lodCount;
+    uint64_t vertexCount, trajectoryCount;
+    uint64_t computedVertices, simplifiedVertices;
+    float boundsMin[3], boundsMax[3];
+};
+
+static const char* CACHE_SUFFIX = ".field";
+
+std::string FieldCache::describe(const IteratedMap& map, const FieldConfig& config) {
+    char line[256];
+    std::string d = "v" + std::to_string(CACHE_VERSION) + " " + map.getName() + "\n";
+    for (const std::string& name : map.getParamNames()) {
+        snprintf(line, sizeof(line), "%s=%.9g\n", name.c_str(), map.getParam(name));
+        d += line;
+    }
+    // Same fields as FieldConfig::operator==
+    snprintf(line, sizeof(line), "resolution=%d iterations=%d range=%.9g center=%.9g,%.9g,%.9g simplify=%.9g sampling=%d\n",
+             config.resolution, config.iterations, config.range, config.cx, config.cy, config.cz, config.simplify,
+             config.sampling);
+    d += line;
+    if (config.sampling != SAMPLING_LATTICE && config.sampling != SAMPLING_ADAPTIVE)
+        d += "seeds=" + std::to_string(config.seedCount) + "\n";
+    if (config.sampling == SAMPLING_ADAPTIVE)
+        d += "refine=" + std::to_string(config.refineDepth) + "," + std::to_string(config.refineBudget) + "\n";
+    return d;
+}
+
+uint64_t FieldCache::hash(const std::string& description) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : description) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+std::string FieldCache::path(const std::string& description) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash(description));
+    return directory + "/" + name + CACHE_SUFFIX;
+}
+
+bool FieldCache::open(const std::string& dir) {
+    std::error_code error;
+    fs::create_directories(dir, error);
+    if (!fs::is_directory(dir, error)) {
+        printf("Cache directory %s is not usable, field cache disabled\n", dir.c_str());
+        directory.clear();
+        return false;
+    }
+    directory = dir;
+    evict();
+    return true;
+}
+
+// Bounds-checked reads from the mapped file
+struct CacheReader {
+    const char* data;
+    size_t size, offset = 0;
+
+    bool read(void* out, size_t bytes) {
+        if (bytes > size - offset) return false;
+        if (bytes) memcpy(out, data + offset, bytes);
+        offset += bytes;
+        return true;
+    }
+    template <typename T>
+    bool read(std::vector<T>& out, size_t count) {
+        if (count > (size - offset) / sizeof(T)) return false;
+        out.resize(count);
+        return read(out.data(), count * sizeof(T));
+    }
+};
+
+bool FieldCache::load(const IteratedMap& map, const FieldConfig& config, Trajectories& out) {
+    if (!enabled()) return false;
+    ProfileZone zone("cache load");
+    auto start = std::chrono::steady_clock::now();
+    const std::string description = describe(map, config);
+    const std::string file = path(description);
+
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        misses++;
+        return false;
+    }
+    struct stat st;
+    void* mapped = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(CacheHeader))
+        mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        misses++;
+        return false;
+    }
+    madvise(mapped, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    // The description guards against hash collisions; a truncated file leaves out cleared, to be recomputed
+    CacheReader reader{(const char*)mapped, (size_t)st.st_size};
+    CacheHeader header;
+    reader.read(&header, sizeof(header));
+    bool ok = header.magic == CACHE_MAGIC && header.version == CACHE_VERSION
+        && header.descriptionBytes == description.size() && description.size() <= reader.size - reader.offset
+        && memcmp(reader.data + reader.offset, description.data(), description.size()) == 0;
+    if (ok) {
+        reader.offset += description.size();
+        out.clear();
+        ok = header.vertexCount <= (reader.size - reader.offset) / sizeof(TrajectoryVertex);
+        if (ok) {
+            out.vertices.resize(header.vertexCount);
+            ok = reader.read(out.vertices.data(), header.vertexCount * sizeof(TrajectoryVertex));
+        }
+        ok = ok && reader.read(out.firsts, header.trajectoryCount) && reader.read(out.counts, header.trajectoryCount);
+        out.lods.resize(ok ? header.lodCount : 0);
+        for (LodLevel& lod : out.lods) {
+            uint32_t stride = 0, chunkCount = 0;
+            ok = ok && reader.read(&stride, sizeof(stride)) && reader.read(&chunkCount, sizeof(chunkCount))
+                && reader.read(lod.firsts, header.trajectoryCount) && reader.read(lod.counts, header.trajectoryCount)
+                && reader.read(lod.errors, header.trajectoryCount)
+                && reader.read(lod.chunkStarts, header.trajectoryCount + 1) && reader.read(lod.chunks, chunkCount);
+            lod.stride = (int)stride;
+        }
+        if (ok) {
+            for (int a = 0; a < 3; a++) {
+                out.boundsMin[a] = header.boundsMin[a];
+                out.boundsMax[a] = header.boundsMax[a];
+            }
+            out.computedVertices = header.computedVertices;
+            out.simplifiedVertices = header.simplifiedVertices;
+        } else {
+            out.clear();
+        }
+    }
+    munmap(mapped, (size_t)st.st_size);
+
+    if (!ok) {
+        printf("Ignoring invalid cache file %s\n", file.c_str());
+        misses++;
+        return false;
+    }
+    // Refresh the modification time: eviction removes the least recently used files first
+    utimensat(AT_FDCWD, file.c_str(), nullptr, 0);
+    hits++;
+    lastLoadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+FieldCache::~FieldCache() {
+    cancelStore();
+}
+
+void FieldCache::cancelStore() {
+    if (!writer.joinable()) return;
+    cancelled = true;
+    writer.join();
+    cancelled = false;
+}
+
+void FieldCache::store(const IteratedMap& map, const FieldConfig& config, const Trajectories& traj, double computeMs) {
+    if (!enabled() || computeMs < minComputeMs) return;
+    cancelStore();
+    // Described now: the map may change while writing
+    std::string description = describe(map, config);
+    writer = std::thread([this, description, &traj] {
+        Profiler::setThreadName("cache writer");
+        ProfileZone zone("cache store");
+        if (write(description, path(description), traj)) {
+            stores++;
+            evict();
+        }
+    });
+}
+
+bool FieldCache::write(const std::string& description, const std::string& file, const Trajectories& traj) {
+    const std::string temporary = file + ".tmp" + std::to_string(getpid());
+    FILE* f = fopen(temporary.c_str(), "wb");
+    if (!f) {
+        printf("Could not write %s\n", temporary.c_str());
+        return false;
+    }
+    CacheHeader header = {};
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.descriptionBytes = (uint32_t)description.size();
+    header.lodCount = (uint32_t)traj.lods.size();
+    header.vertexCount = traj.vertices.size();
+    header.trajectoryCount = (uint64_t)traj.size();
+    header.computedVertices = traj.computedVertices;
+    header.simplifiedVertices = traj.simplifiedVertices;
+    for (int a = 0; a < 3; a++) {
+        header.boundsMin[a] = traj.boundsMin[a];
+        header.boundsMax[a] = traj.boundsMax[a];
+    }
+
+    // In blocks of a few MB, checking for cancellation in between
+    auto write = [&](const void* data, size_t bytes) {
+        const size_t block = 4 << 20;
+        for (size_t at = 0; at < bytes; at += block) {
+            size_t n = std::min(block, bytes - at);
+            if (cancelled || fwrite((const char*)data + at, 1, n, f) != n) return false;
+        }
+        return true;
+    };
+    bool ok = write(&header, sizeof(header)) && write(description.data(), description.size())
+        && write(traj.vertices.data(), traj.vertexBytes())
+        && write(traj.firsts.data(), traj.firsts.size() * sizeof(int))
+        && write(traj.counts.data(), traj.counts.size() * sizeof(int));
+    for (const LodLevel& lod : traj.lods) {
+        uint32_t stride = (uint32_t)lod.stride, chunkCount = (uint32_t)lod.chunks.size();
+        ok = ok && write(&stride, sizeof(stride)) && write(&chunkCount, sizeof(chunkCount))
+            && write(lod.firsts.data(), lod.firsts.size() * sizeof(int))
+            && write(lod.counts.data(), lod.counts.size() * sizeof(int))
+            && write(lod.errors.data(), lod.errors.size() * sizeof(float))
+            && write(lod.chunkStarts.data(), lod.chunkStarts.size() * sizeof(int))
+            && write(lod.chunks.data(), lod.chunks.size() * sizeof(TrajectoryChunk));
+    }
+    ok = (fclose(f) == 0) && ok;
+
+    // Renamed into place once complete, so readers never see a partial file
+    if (!ok || rename(temporary.c_str(), file.c_str()) != 0) {
+        if (!cancelled) printf("Could not write %s\n", file.c_str());
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+void FieldCache::evict() {
+    struct Entry {
+        fs::path path;
+        fs::file_time_type time;
+        long long bytes;
+    };
+    std::vector<Entry> entries;
+    std::error_code error;
+    for (const fs::directory_entry& e : fs::directory_iterator(directory, error)) {
+        if (!e.is_regular_file(error) || e.path().extension() != CACHE_SUFFIX) continue;
+        entries.push_back({e.path(), e.last_write_time(error), (long long)e.file_size(error)});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+
+    long long total = 0;
+    for (const Entry& e : entries) total += e.bytes;
+    int count = (int)entries.size();
+    for (const Entry& e : entries) {
+        if (total <= maxBytes) break;
+        if (!fs::remove(e.path, error)) continue;
+        total -= e.bytes;
+        count--;
+    }
+    bytes = total;
+    files = count;
+}
@@ -1,46 +1,543 @@
+#include <cstddef>
+
 #include "../inc/FieldVisualizer.hpp"
+#include "../inc/Colormap.hpp"
+#include "../inc/Shader.hpp"
+#include "../inc/Profiler.hpp"
 
-FieldVisualizer::FieldVisualizer(std::unique_ptr<IteratedMap> m) : map(std::move(m)) {}
+// Speed is normalized and looked up in the colormap texture on the GPU,
+// so changing colormap or normalization does not touch the vertex buffer
+static const char* FIELD_VS = R"(
+#version 120
+attribute vec3 aPosition;
+attribute float aSpeed;
+uniform float uSpeedScale;
+uniform float uPointSize;
+varying float vT;
+void main() {
+    vT = clamp(aSpeed * uSpeedScale, 0.0, 1.0);
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(aPosition, 1.0);
+    // Point mode only (GL_VERTEX_PROGRAM_POINT_SIZE): uPointSize is in pixels at unit distance
+    gl_PointSize = max(1.0, uPointSize / gl_Position.w);
+}
+)";
 
-void FieldVisualizer::draw() {
-    const float scale = map->getScale();
-    float step = (range * 2.0f) / (float)(resolution > 1 ? resolution - 1 : 1);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+// Same for CompactVertex: normalized 16-bit positions within the field bounds, sqrt-encoded 8-bit speed
+static const char* COMPACT_FIELD_VS = R"(
+#version 120
+attribute vec3 aPosition;
+attribute float aSpeed;
+uniform vec3 uOrigin;
+uniform vec3 uExtent;
+uniform float uMaxSpeed;
+uniform float uSpeedScale;
+uniform float uPointSize;
+varying float vT;
+void main() {
+    vT = clamp(aSpeed * aSpeed * uMaxSpeed * uSpeedScale, 0.0, 1.0);
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(uOrigin + aPosition * uExtent, 1.0);
+    gl_PointSize = max(1.0, uPointSize / gl_Position.w);
+}
+)";
+
+static const char* FIELD_FS = R"(
+#version 120
+uniform sampler1D uColormap;
+uniform float uAlpha;
+varying float vT;
+void main() {
+    // Sample texel centers so t = 0 and t = 1 hit the first and last entries
+    float u = (vT * 255.0 + 0.5) / 256.0;
+    gl_FragColor = vec4(texture1D(uColormap, u).rgb, uAlpha);
+}
+)";
+
+// Point sprites: round, fading towards the edge
+static const char* POINT_FS = R"(
+#version 120
+uniform sampler1D uColormap;
+uniform float uAlpha;
+varying float vT;
+void main() {
+    vec2 d = gl_PointCoord * 2.0 - 1.0;
+    float r2 = dot(d, d);
+    if (r2 > 1.0) discard;
+    float u = (vT * 255.0 + 0.5) / 256.0;
+    gl_FragColor = vec4(texture1D(uColormap, u).rgb, uAlpha * (1.0 - r2));
+}
+)";
+
+void FieldVisualizer::FieldProgram::create(const char* vertexShader, const char* fragmentShader) {
+    const char* attribs[] = {"aPosition", "aSpeed", nullptr};
+    id = createProgram(vertexShader, fragmentShader, attribs);
+    uSpeedScale = glGetUniformLocation(id, "uSpeedScale");
+    uAlpha = glGetUniformLocation(id, "uAlpha");
+    uColormap = glGetUniformLocation(id, "uColormap");
+    uOrigin = glGetUniformLocation(id, "uOrigin");
+    uExtent = glGetUniformLocation(id, "uExtent");
+    uMaxSpeed = glGetUniformLocation(id, "uMaxSpeed");
+    uPointSize = glGetUniformLocation(id, "uPointSize");
+}
+
+// Density points: opacity grows with the density too, so sparse voxels do not wash out dense ones
+static const char* DENSITY_FS = R"(
+#version 120
+uniform sampler1D uColormap;
+uniform float uAlpha;
+varying float vT;
+void main() {
+    float u = (vT * 255.0 + 0.5) / 256.0;
+    gl_FragColor = vec4(texture1D(uColormap, u).rgb, uAlpha * vT);
+}
+)";
+
+FieldVisualizer::FieldVisualizer(std::unique_ptr<IteratedMap> m) : map(std::move(m)), names(map->getParamNames()) {
+    if ((int)names.size() > MAX_PARAMS) {
+        printf("%s has more than %d parameters, the others do not trigger recomputation\n", map->getName(), MAX_PARAMS);
+        names.resize(MAX_PARAMS);
+    }
+    fullProgram.create(FIELD_VS, FIELD_FS);
+    compactProgram.create(COMPACT_FIELD_VS, FIELD_FS);
+    densityProgram.create(FIELD_VS, DENSITY_FS);
+    pointProgram.create(FIELD_VS, POINT_FS);
+    compactPointProgram.create(COMPACT_FIELD_VS, POINT_FS);
+
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &densityVbo);
+
+    glGenTextures(1, &colormapTexture);
+    glBindTexture(GL_TEXTURE_1D, colormapTexture);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_1D, 0);
+
+    std::vector<float> edges;
+    for (int axis = 0; axis < 3; axis++) {
+        for (int corner = 0; corner < 4; corner++) {
+            float a = (corner & 1) ? 0.5f : -0.5f, b = (corner & 2) ? 0.5f : -0.5f;
+            float from[3], to[3];
+            from[axis] = -0.5f; to[axis] = 0.5f;
+            from[(axis + 1) % 3] = to[(axis + 1) % 3] = a;
+            from[(axis + 2) % 3] = to[(axis + 2) % 3] = b;
+            edges.insert(edges.end(), {from[0], from[1], from[2], to[0], to[1], to[2]});
+        }
+    }
+    box.upload(edges);
+}
+
+FieldVisualizer::~FieldVisualizer() {
+    glDeleteTextures(1, &colormapTexture);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &densityVbo);
+    glDeleteTextures(1, &poincareTexture);
+    glDeleteProgram(fullProgram.id);
+    glDeleteProgram(compactProgram.id);
+    glDeleteProgram(densityProgram.id);
+    glDeleteProgram(pointProgram.id);
+    glDeleteProgram(compactPointProgram.id);
+}
+
+FieldConfig FieldVisualizer::config() const {
+    FieldConfig c;
+    c.resolution = resolution;
+    c.iterations = iterations;
+    c.range = range;
+    c.cx = cx; c.cy = cy; c.cz = cz;
+    c.sampling = sampling;
+    c.seedCount = seedCount;
+    c.refineDepth = refineDepth;
+    c.refineBudget = refineBudget;
+    c.simplify = simplify;
+    return c;
+}
+
+std::vector<float> FieldVisualizer::params() const {
+    std::vector<float> values;
+    for (const std::string& name : names) values.push_back(map->getParam(name));
+    return values;
+}
+
+void FieldVisualizer::upload() {
+    ProfileZone zone("upload");
+    const void* data = trajectories.vertices.data();
+    bufferBytes = (long long)trajectories.vertexBytes();
+    if (compact) {
+        quantizeVertices(trajectories, quantized);
+        data = quantized.vertices.data();
+        bufferBytes = (long long)quantized.vertices.size() * sizeof(CompactVertex);
+    }
+
+    // The GPU buffer only grows too: smaller fields are written into the existing storage
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (bufferBytes > vboCapacity) {
+        vboCapacity = bufferBytes;
+        glBufferData(GL_ARRAY_BUFFER, vboCapacity, NULL, GL_STATIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bufferBytes, data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    uploadedCompact = compact;
+}
+
+void FieldVisualizer::fieldChanged() {
+    upload();
+    computedConfig = config();
+    currentParams(computedParams);
+    computed = true;
+}
+
+void FieldVisualizer::stopCacheStore() {
+    if (cache) cache->cancelStore();
+    storePending = false;
+}
+
+bool FieldVisualizer::loadOrbit(const std::string& path, long long maxPoints) {
+    stopCacheStore();
+    if (!::loadOrbit(path, map->getScale(), trajectories, maxPoints)) return false;
+    buildLods(trajectories);
+    fieldChanged();
+    return true;
+}
+
+void FieldVisualizer::currentParams(std::array<float, MAX_PARAMS>& values) const {
+    for (size_t i = 0; i < names.size(); i++) values[i] = map->getParam(names[i]);
+}
+
+bool FieldVisualizer::paramsEqual(const std::array<float, MAX_PARAMS>& values) const {
+    for (size_t i = 0; i < names.size(); i++)
+        if (map->getParam(names[i]) != values[i]) return false;
+    return true;
+}
+
+bool FieldVisualizer::stale() const {
+    return !computed || config() != computedConfig || !paramsEqual(computedParams);
+}
+
+void FieldVisualizer::adopt(Trajectories computedField) {
+    stopCacheStore();
+    trajectories = std::move(computedField);
+    fieldChanged();
+}
+
+Trajectories& FieldVisualizer::fieldStorage() {
+    stopCacheStore();
+    return trajectories;
+}
+
+void FieldVisualizer::adoptInPlace() {
+    fieldChanged();
+}
+
+void FieldVisualizer::update() {
+    // The density only holds the field it was started for: start over on any change
+    if (largeField && (config() != largeBase || !paramsEqual(largeParams))) {
+        largeRestarts++;
+        launchLargeField();
+    }
+
+    if (stale()) {
+        // Computed in place, reusing the storage of the previous field (which the cache may be writing)
+        stopCacheStore();
+        if (countKernels) {
+            if (!counters) counters = std::make_unique<PerfCounters>();
+            counters->start();
+        }
+        const FieldConfig c = config();
+        if (!cache || !cache->load(*map, c, trajectories)) {
+            auto start = std::chrono::steady_clock::now();
+            computeField(*map, c, trajectories);
+            buildLods(trajectories);
+            storeComputeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            computedAt = std::chrono::steady_clock::now();
+            storePending = cache != nullptr;
+        }
+        if (countKernels) {
+            counters->stop();
+            computeCounters = std::to_string(counters->seconds * 1e3).substr(0, 5) + " ms, " + counters->summary();
+        }
+        fieldChanged();
+    } else if (compact != uploadedCompact) {
+        upload();
+    }
+
+    // Cached once the settings stop changing, written in the background
+    if (storePending && std::chrono::duration<double>(std::chrono::steady_clock::now() - computedAt).count()
+                            >= cache->storeDelaySeconds) {
+        cache->store(*map, computedConfig, trajectories, storeComputeMs);
+        storePending = false;
+    }
+
+    colormap = (colormap % colormapCount() + colormapCount()) % colormapCount();
+    if (colormap != uploadedColormap) {
+        std::vector<unsigned char> lut;
+        buildColormap(colormap, lut);
+        glBindTexture(GL_TEXTURE_1D, colormapTexture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB8, COLORMAP_SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, lut.data());
+        glBindTexture(GL_TEXTURE_1D, 0);
+        uploadedColormap = colormap;
+    }
+}
+
+void FieldVisualizer::startLargeField(int resolution, int gridSize) {
+    largeResolution = resolution;
+    largeGridSize = gridSize;
+    largeRestarts = 0;
+    launchLargeField();
+}
 
-    for (int i = 0; i < resolution; i++) {
-        for (int j = 0; j < resolution; j++) {
-            for (int k = 0; k < resolution; k++) {
-                // Initial point in visualization space, scaled to map space
-                float x = (cx - range + (i * step)) * scale;
-                float y = (cy - range + (j * step)) * scale;
-                float z = (cz - range + (k * step)) * scale;
-
-                glBegin(GL_LINE_STRIP);
-                for (int n = 0; n < iterations; n++) {
-                    float px = x, py = y, pz = z;
-                    map->iterate(x, y, z);
-
-                    // dist is in map space, scale it back for color
-                    float dist = sqrt(pow(x-px,2) + pow(y-py,2) + pow(z-pz,2));
-                    float t = std::min((dist / scale) / 1.5f, 1.0f);
-                    glColor4f(1.0f - t, 0.2f, t, 0.6f);
-
-                    // draw vertex in visualization space
-                    glVertex3f(px / scale, py / scale, pz / scale);
-                    
-                    if (map->hasEscaped(x, y, z)) break;
-                }
-                glEnd();
+void FieldVisualizer::launchLargeField() {
+    // The previous job is cancelled (its workers joined) and its grid freed before the next is allocated
+    largeField.reset();
+    largeBase = config();
+    currentParams(largeParams);
+    FieldConfig c = largeBase;
+    c.resolution = largeResolution;
+    largeField = std::make_unique<LargeFieldJob>(*map, c, largeGridSize);
+    densityPoints = -1;
+}
+
+void FieldVisualizer::stopLargeField() {
+    largeField.reset();
+    densityPoints = -1;
+}
+
+void FieldVisualizer::startPoincare(const PoincareConfig& config) {
+    poincare = std::make_unique<PoincareJob>(*map, this->config(), config);
+    poincareUploaded = -1;
+    poincareFinal = false;
+}
+
+void FieldVisualizer::stopPoincare() {
+    poincare.reset();
+}
+
+void FieldVisualizer::drawPoincare(int fbWidth, int fbHeight) {
+    if (!poincare) return;
+    // Twice a second while computing, once more when done
+    double now = glfwGetTime();
+    if (!poincareFinal && (poincareUploaded < 0 || now - poincareUploaded > 0.5 || poincare->done())) {
+        poincareFinal = poincare->done();
+        const PoincareHistogram& section = poincare->histogram();
+        std::vector<unsigned char> rgb;
+        section.toImage(colormap, rgb);
+        if (!poincareTexture) glGenTextures(1, &poincareTexture);
+        glBindTexture(GL_TEXTURE_2D, poincareTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, section.size, section.size, 0, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        poincareUploaded = now;
+    }
+
+    // Square in the top-right corner, a third of the window height, in framebuffer pixels (y down)
+    float side = fbHeight / 3.0f, x0 = fbWidth - 20.0f - side, y0 = 20.0f;
+    const float quad[] = {x0, y0, 0, 1,  x0 + side, y0, 1, 1,  x0 + side, y0 + side, 1, 0,  x0, y0 + side, 0, 0};
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_VIEWPORT_BIT);
+    glViewport(0, 0, fbWidth, fbHeight);
+    glMatrixMode(GL_PROJECTION); glPushMatrix(); glLoadIdentity();
+    gluOrtho2D(0, fbWidth, fbHeight, 0);
+    glMatrixMode(GL_MODELVIEW); glPushMatrix(); glLoadIdentity();
+
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, poincareTexture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 4 * sizeof(float), quad);
+    glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(float), quad + 2);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+    glColor3f(0.5f, 0.5f, 0.5f);
+    glDrawArrays(GL_LINE_LOOP, 0, 4);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    glPopMatrix(); glMatrixMode(GL_PROJECTION); glPopMatrix(); glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+}
+
+bool FieldVisualizer::densityReady() {
+    if (!largeField || !largeField->done()) return false;
+    if (densityPoints < 0) {
+        std::vector<TrajectoryVertex> points;
+        largeField->result().toVertices(points);
+        glBindBuffer(GL_ARRAY_BUFFER, densityVbo);
+        glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(TrajectoryVertex), points.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        densityPoints = (int)points.size();
+    }
+    return true;
+}
+
+void FieldVisualizer::draw(const Camera& cam, int viewportHeight) {
+    update();
+    if (densityReady()) {
+        // Density is normalized to [0, 1] already: colormap it directly
+        drawnVertices = fieldVertices = densityPoints;
+        drawnChunks = culledChunks = 0;
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        glPointSize(2.0f);
+        glUseProgram(densityProgram.id);
+        glUniform1f(densityProgram.uSpeedScale, 1.0f);
+        glUniform1f(densityProgram.uAlpha, 0.3f);
+        glUniform1i(densityProgram.uColormap, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_1D, colormapTexture);
+        glBindBuffer(GL_ARRAY_BUFFER, densityVbo);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TrajectoryVertex), (void*)offsetof(TrajectoryVertex, x));
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(TrajectoryVertex), (void*)offsetof(TrajectoryVertex, speed));
+        glDrawArrays(GL_POINTS, 0, densityPoints);
+        glDisableVertexAttribArray(0);
+        glDisableVertexAttribArray(1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_1D, 0);
+        glUseProgram(0);
+        glPointSize(1.0f);
+        return;
+    }
+
+    const FieldProgram& program = points ? (compact ? compactPointProgram : pointProgram)
+                                         : (compact ? compactProgram : fullProgram);
+    if (!program.id || trajectories.size() == 0) return;
+
+    // Pixel scale at the point of the field bounds closest to the eye
+    float eye[3];
+    cam.eye(eye[0], eye[1], eye[2]);
+    float dist2 = 0.0f;
+    for (int a = 0; a < 3; a++) {
+        float d = std::max({trajectories.boundsMin[a] - eye[a], 0.0f, eye[a] - trajectories.boundsMax[a]});
+        dist2 += d * d;
+    }
+    float pxPerUnit = cam.pixelsPerUnit(std::sqrt(dist2), viewportHeight);
+    positionErrorPx = compact ? quantized.maxPositionError * pxPerUnit : 0.0f;
+    colorErrorSteps = compact ? quantized.maxSpeedError * speedScale * (COLORMAP_SIZE - 1) : 0.0f;
+
+    Frustum frustum;
+    frustum.extract();
+
+    // Pick for each trajectory the coarsest level whose error stays under the pixel bound,
+    // then only submit the chunks of that level intersecting the view frustum
+    drawFirsts.clear();
+    drawCounts.clear();
+    drawnVertices = 0;
+    fieldVertices = 0;
+    drawnChunks = 0;
+    culledChunks = 0;
+    for (int t = 0; t < trajectories.size(); t++) {
+        fieldVertices += trajectories.counts[t];
+        // Points are all drawn: decimating them would change the density
+        int level = 0;
+        for (int l = points ? 0 : (int)trajectories.lods.size() - 1; l > 0; l--) {
+            if (trajectories.lods[l].errors[t] * pxPerUnit <= lodErrorPx) {
+                level = l;
+                break;
+            }
+        }
+        const LodLevel& lod = trajectories.lods[level];
+        for (int c = lod.chunkStarts[t]; c < lod.chunkStarts[t + 1]; c++) {
+            const TrajectoryChunk& chunk = lod.chunks[c];
+            if (!frustum.intersects(chunk.min, chunk.max)) {
+                culledChunks++;
+                continue;
             }
+            // Merge with the previous chunk when contiguous to keep draw lists short
+            if (!drawFirsts.empty() && drawFirsts.back() + drawCounts.back() - 1 == chunk.first) {
+                drawCounts.back() += chunk.count - 1;
+            } else {
+                drawFirsts.push_back(chunk.first);
+                drawCounts.push_back(chunk.count);
+            }
+            drawnChunks++;
+            drawnVertices += chunk.count;
         }
     }
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+
+    glUseProgram(program.id);
+    glUniform1f(program.uSpeedScale, speedScale);
+    glUniform1f(program.uAlpha, points ? pointAlpha : 0.6f);
+    glUniform1f(program.uPointSize, pointSize * cam.pixelsPerUnit(1.0f, viewportHeight));
+    glUniform1i(program.uColormap, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_1D, colormapTexture);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    if (compact) {
+        glUniform3fv(program.uOrigin, 1, quantized.origin);
+        glUniform3fv(program.uExtent, 1, quantized.extent);
+        glUniform1f(program.uMaxSpeed, quantized.maxSpeed);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex),
+                              (void*)offsetof(CompactVertex, x));
+        glVertexAttribPointer(1, 1, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(CompactVertex),
+                              (void*)offsetof(CompactVertex, speed));
+    } else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TrajectoryVertex),
+                              (void*)offsetof(TrajectoryVertex, x));
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(TrajectoryVertex),
+                              (void*)offsetof(TrajectoryVertex, speed));
+    }
+
+    if (points) {
+        glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+        glEnable(GL_POINT_SPRITE);
+        glDepthMask(GL_FALSE);  // additive: order independent, no point hides another
+        glMultiDrawArrays(GL_POINTS, drawFirsts.data(), drawCounts.data(), (GLsizei)drawFirsts.size());
+        glDepthMask(GL_TRUE);
+        glDisable(GL_POINT_SPRITE);
+        glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
+    } else {
+        glMultiDrawArrays(GL_LINE_STRIP, drawFirsts.data(), drawCounts.data(), (GLsizei)drawFirsts.size());
+    }
+
+    glDisableVertexAttribArray(0);
+    glDisableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glUseProgram(0);
 }
 
 void FieldVisualizer::drawBox() {
     glPushMatrix();
     glTranslatef(cx, cy, cz);
+    glScalef(range * 2.0f, range * 2.0f, range * 2.0f);
     glColor4f(1.0f, 1.0f, 1.0f, 0.3f);
-    glutWireCube(range * 2.0f);
+    box.draw();
     glPopMatrix();
 }
+
+void renderScene(Camera& cam, FieldVisualizer& field, int width, int height, const ViewTile& tile) {
+    glClearColor(0, 0, 0, 1);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderView(cam, field, 0, 0, width, height, tile);
+}
+
+void renderView(Camera& cam, FieldVisualizer& field, int x, int y, int width, int height, const ViewTile& tile) {
+    glViewport(x, y, width, height);
+
+    // Perspective of the whole image, narrowed to this tile's part of the near plane
+    double top = cam.zNear * tan(cam.fov * M_PI / 360.0);
+    double right = top * (double)(width * tile.columns) / (height * tile.rows);
+    double l = -right + 2 * right * tile.column / tile.columns, r = -right + 2 * right * (tile.column + 1) / tile.columns;
+    double b = -top + 2 * top * tile.row / tile.rows, t = -top + 2 * top * (tile.row + 1) / tile.rows;
+    glMatrixMode(GL_PROJECTION); glLoadIdentity();
+    glFrustum(l, r, b, t, cam.zNear, cam.zFar);
+    glMatrixMode(GL_MODELVIEW); glLoadIdentity();
+
+    cam.apply();
+    drawInfiniteGrid(cam.theta, cam.phi, cam.radius);
+    field.drawBox();
+    field.draw(cam, height * tile.rows);
+}
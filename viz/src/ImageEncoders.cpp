@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <thread>
+
+#include <zlib.h>
+
+#include "../inc/ImageEncoders.hpp"
+#include "../inc/PerfCounters.hpp"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../inc/stb_image_write.h"
+
+static void putBigEndian(std::vector<unsigned char>& out, uint32_t v) {
+    unsigned char b[4] = {(unsigned char)(v >> 24), (unsigned char)(v >> 16), (unsigned char)(v >> 8), (unsigned char)v};
+    out.insert(out.end(), b, b + 4);
+}
+
+static void pngChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t size) {
+    putBigEndian(out, (uint32_t)size);
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (size) out.insert(out.end(), data, data + size);
+    putBigEndian(out, (uint32_t)crc32(0, out.data() + start, (uInt)(size + 4)));
+}
+
+static inline unsigned char paeth(int a, int b, int c) {
+    int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return (unsigned char)a;
+    return (unsigned char)(pb <= pc ? b : c);
+}
+
+// Filter one row into out (filter byte + stride bytes), keeping the Sub / Up / Paeth candidate
+// with the smallest sum of absolute (signed) residuals, the usual libpng heuristic
+static void filterRow(const unsigned char* row, const unsigned char* prev, size_t stride,
+                      unsigned char* out, std::vector<unsigned char>& scratch) {
+    scratch.resize(stride);
+    unsigned char* best = out + 1;
+    long bestSum = -1;
+    for (int type = 1; type <= 4; type++) {
+        if (type == 3 || (type != 1 && !prev)) continue;  // no Average, no Up/Paeth on the first row
+        unsigned char* dst = best == out + 1 && bestSum >= 0 ? scratch.data() : out + 1;
+        long sum = 0;
+        for (size_t i = 0; i < stride; i++) {
+            int left = i >= 3 ? row[i - 3] : 0;
+            int up = prev ? prev[i] : 0;
+            int upLeft = prev && i >= 3 ? prev[i - 3] : 0;
+            int predicted = type == 1 ? left : type == 2 ? up : paeth(left, up, upLeft);
+            dst[i] = (unsigned char)(row[i] - predicted);
+            sum += abs((signed char)dst[i]);
+        }
+        if (bestSum < 0 || sum < bestSum) {
+            bestSum = sum;
+            best = dst;
+            out[0] = (unsigned char)type;
+        }
+    }
+    if (best != out + 1) memcpy(out + 1, best, stride);
+}
+
+// Raw deflate of image rows [first, last), ending on a byte boundary (sync flush) so bands can be
+// concatenated; the last band finishes the stream. Also returns the Adler-32 of the band's bytes.
+// False if zlib reports an error (out is then incomplete).
+static bool deflateBand(const unsigned char* pixels, int width, int height, int first, int last,
+                        int level, bool final, std::vector<unsigned char>& out, uLong& adler) {
+    size_t stride = (size_t)width * 3;
+    std::vector<unsigned char> filtered(stride + 1), scratch;
+    z_stream zs{};
+    if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+    out.resize(deflateBound(&zs, (uLong)((last - first) * (stride + 1))) + 64);
+    zs.next_out = out.data();
+    zs.avail_out = (uInt)out.size();
+    adler = adler32(0, nullptr, 0);
+
+    bool ok = true;
+    for (int y = first; y < last && ok; y++) {
+        // Image row y (top-down) is OpenGL row height - 1 - y
+        const unsigned char* row = pixels + (size_t)(height - 1 - y) * stride;
+        const unsigned char* prev = y > 0 ? row + stride : nullptr;
+        if (level == 0) {
+            filtered[0] = 0;
+            memcpy(filtered.data() + 1, row, stride);
+        } else {
+            filterRow(row, prev, stride, filtered.data(), scratch);
+        }
+        adler = adler32(adler, filtered.data(), (uInt)filtered.size());
+        zs.next_in = filtered.data();
+        zs.avail_in = (uInt)filtered.size();
+        int flush = y + 1 < last ? Z_NO_FLUSH : final ? Z_FINISH : Z_SYNC_FLUSH;
+        for (;;) {
+            int status = deflate(&zs, flush);
+            // Done once the row is consumed (and flushed) with room to spare, or the stream ended
+            if (flush == Z_FINISH ? status == Z_STREAM_END : status == Z_OK && zs.avail_out != 0) break;
+            if ((status != Z_OK && status != Z_BUF_ERROR) || zs.avail_out != 0) {
+                ok = false;
+                break;
+            }
+            // Output full (the bound was exceeded by flush markers): grow it and continue
+            size_t used = out.size() - zs.avail_out;
+            out.resize(out.size() * 2);
+            zs.next_out = out.data() + used;
+            zs.avail_out = (uInt)(out.size() - used);
+        }
+    }
+    out.resize(out.size() - zs.avail_out);
+    deflateEnd(&zs);
+    return ok;
+}
+
+bool encodePng(const unsigned char* pixels, int width, int height, std::vector<unsigned char>& out,
+               int level, int threads) {
+    out.clear();
+    if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int bands = std::clamp(threads, 1, std::max(1, height));
+
+    std::vector<std::vector<unsigned char>> compressed(bands);
+    std::vector<uLong> adlers(bands);
+    std::vector<std::future<bool>> pending;
+    auto band = [&](int b) {
+        return deflateBand(pixels, width, height, height * b / bands, height * (b + 1) / bands, level, b == bands - 1,
+                           compressed[b], adlers[b]);
+    };
+    for (int b = 1; b < bands; b++) pending.push_back(std::async(std::launch::async, band, b));
+    bool ok = band(0);
+    for (std::future<bool>& p : pending) ok = p.get() && ok;
+    if (!ok) return false;
+
+    static const unsigned char signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+    out.insert(out.end(), signature, signature + 8);
+    unsigned char ihdr[13] = {0};
+    for (int i = 0; i < 4; i++) {
+        ihdr[i] = (unsigned char)(width >> (24 - 8 * i));
+        ihdr[4 + i] = (unsigned char)(height >> (24 - 8 * i));
+    }
+    ihdr[8] = 8;  // bits per channel
+    ihdr[9] = 2;  // RGB
+    pngChunk(out, "IHDR", ihdr, sizeof(ihdr));
+
+    // One IDAT per band: zlib header before the first, combined Adler-32 after the last
+    size_t stride = (size_t)width * 3 + 1;
+    uLong adler = adlers[0];
+    for (int b = 1; b < bands; b++) {
+        size_t length = (size_t)(height * (b + 1) / bands - height * b / bands) * stride;
+        adler = adler32_combine(adler, adlers[b], (z_off_t)length);
+    }
+    compressed[0].insert(compressed[0].begin(), {0x78, 0x01});
+    for (int i = 3; i >= 0; i--) compressed[bands - 1].push_back((unsigned char)(adler >> (8 * i)));
+    for (const std::vector<unsigned char>& data : compressed) pngChunk(out, "IDAT", data.data(), data.size());
+    pngChunk(out, "IEND", nullptr, 0);
+    return true;
+}
+
+void encodeQoi(const unsigned char* pixels, int width, int height, std::vector<unsigned char>& out) {
+    out.clear();
+    out.reserve(14 + (size_t)width * height * 4 + 8);
+    out.insert(out.end(), {'q', 'o', 'i', 'f'});
+    putBigEndian(out, width);
+    putBigEndian(out, height);
+    out.push_back(3);  // RGB
+    out.push_back(0);  // sRGB
+
+    // Alpha is always 255, but the index holds RGBA and starts zeroed as in the decoder: an empty
+    // entry must not match opaque black
+    unsigned char index[64][4] = {};
+    int pr = 0, pg = 0, pb = 0, run = 0;
+    size_t stride = (size_t)width * 3;
+    for (int y = 0; y < height; y++) {
+        const unsigned char* p = pixels + (size_t)(height - 1 - y) * stride;
+        for (int x = 0; x < width; x++, p += 3) {
+            int r = p[0], g = p[1], b = p[2];
+            if (r == pr && g == pg && b == pb) {
+                if (++run == 62) {
+                    out.push_back(0xc0 | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run) {
+                out.push_back(0xc0 | (run - 1));
+                run = 0;
+            }
+            int hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+            if (index[hash][0] == r && index[hash][1] == g && index[hash][2] == b && index[hash][3] == 255) {
+                out.push_back((unsigned char)hash);
+            } else {
+                index[hash][0] = r; index[hash][1] = g; index[hash][2] = b; index[hash][3] = 255;
+                int dr = (signed char)(r - pr), dg = (signed char)(g - pg), db = (signed char)(b - pb);
+                int drg = dr - dg, dbg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    out.push_back((unsigned char)(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                    out.push_back((unsigned char)(0x80 | (dg + 32)));
+                    out.push_back((unsigned char)((drg + 8) << 4 | (dbg + 8)));
+                } else {
+                    out.insert(out.end(), {0xfe, (unsigned char)r, (unsigned char)g, (unsigned char)b});
+                }
+            }
+            pr = r; pg = g; pb = b;
+        }
+    }
+    if (run) out.push_back(0xc0 | (run - 1));
+    out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+}
+
+bool decodeQoi(const std::vector<unsigned char>& data, int& width, int& height, std::vector<unsigned char>& rgba) {
+    if (data.size() < 22 || memcmp(data.data(), "qoif", 4) != 0) return false;
+    auto bigEndian = [&](size_t at) { return (int)((unsigned)data[at] << 24 | data[at + 1] << 16 | data[at + 2] << 8 | data[at + 3]); };
+    width = bigEndian(4);
+    height = bigEndian(8);
+    if (width <= 0 || height <= 0) return false;
+    size_t pixels = (size_t)width * height;
+    rgba.resize(pixels * 4);
+
+    unsigned char index[64][4] = {};
+    unsigned char px[4] = {0, 0, 0, 255};
+    size_t at = 14, end = data.size() - 8;
+    int run = 0;
+    for (size_t i = 0; i < pixels; i++) {
+        if (run) {
+            run--;
+        } else if (at < end) {
+            int op = data[at++];
+            if (op == 0xfe && at + 3 <= end) {
+                px[0] = data[at]; px[1] = data[at + 1]; px[2] = data[at + 2];
+                at += 3;
+            } else if (op == 0xff && at + 4 <= end) {
+                memcpy(px, &data[at], 4);
+                at += 4;
+            } else if ((op & 0xc0) == 0x00) {
+                memcpy(px, index[op], 4);
+            } else if ((op & 0xc0) == 0x40) {
+                px[0] += ((op >> 4) & 3) - 2;
+                px[1] += ((op >> 2) & 3) - 2;
+                px[2] += (op & 3) - 2;
+            } else if ((op & 0xc0) == 0x80 && at < end) {
+                int dg = (op & 0x3f) - 32, next = data[at++];
+                px[0] += dg - 8 + (next >> 4);
+                px[1] += dg;
+                px[2] += dg - 8 + (next & 0x0f);
+            } else if ((op & 0xc0) == 0xc0) {
+                run = op & 0x3f;
+            } else {
+                return false;
+            }
+        } else {
+            return false;
+        }
+        int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+        memcpy(index[hash], px, 4);
+        memcpy(&rgba[i * 4], px, 4);
+    }
+    return true;
+}
+
+void encodePpm(const unsigned char* pixels, int width, int height, std::vector<unsigned char>& out) {
+    char header[32];
+    int length = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+    size_t stride = (size_t)width * 3;
+    out.resize(length + stride * height);
+    memcpy(out.data(), header, length);
+    for (int y = 0; y < height; y++) memcpy(out.data() + length + y * stride, pixels + (size_t)(height - 1 - y) * stride, stride);
+}
+
+bool writeFile(const std::string& path, const std::vector<unsigned char>& data) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+static void appendToVector(void* context, void* data, int size) {
+    auto* out = (std::vector<unsigned char>*)context;
+    out->insert(out->end(), (unsigned char*)data, (unsigned char*)data + size);
+}
+
+void benchmarkEncoders(const unsigned char* pixels, int width, int height) {
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    size_t input = (size_t)width * height * 3;
+    std::vector<unsigned char> out;
+    struct Encoder {
+        const char* name;
+        std::function<void()> run;
+    };
+    int stride = width * 3;
+    const Encoder encoders[] = {
+        {"stb_image_write PNG", [&] { out.clear(); stbi_write_png_to_func(appendToVector, &out, width, height, 3,
+                                                                             pixels + (size_t)(height - 1) * stride, -stride); }},
+        {"PNG, 1 thread", [&] { encodePng(pixels, width, height, out, 6, 1); }},
+        {"PNG, all threads", [&] { encodePng(pixels, width, height, out, 6, threads); }},
+        {"PNG level 1", [&] { encodePng(pixels, width, height, out, 1, threads); }},
+        {"PNG uncompressed", [&] { encodePng(pixels, width, height, out, 0, threads); }},
+        {"QOI", [&] { encodeQoi(pixels, width, height, out); }},
+        {"PPM", [&] { encodePpm(pixels, width, height, out); }},
+    };
+
+    printf("Encoding a %dx%d frame (%.1f MB RGB), %d threads:\n", width, height, input / 1e6, threads);
+    PerfCounters counters;
+    if (!counters.anyAvailable()) printf("  %s\n", counters.summary().c_str());
+    for (const Encoder& e : encoders) {
+        // Best of a few runs, after one warm-up; counters of the best run
+        e.run();
+        double best = 1e30;
+        std::string bestCounters;
+        for (int i = 0; i < 3; i++) {
+            counters.start();
+            e.run();
+            counters.stop();
+            if (counters.seconds < best) {
+                best = counters.seconds;
+                if (counters.anyAvailable()) bestCounters = counters.summary();
+            }
+        }
+        printf("  %-22s %8.1f ms %9.1f MB/s  %7.2f MB (%4.1f%%)  %s\n", e.name, best * 1e3, input / best / 1e6,
+               out.size() / 1e6, 100.0 * out.size() / input, bestCounters.c_str());
+    }
+
+    // The QOI output must decode back to the frame, opaque, with a decoder following the specification
+    encodeQoi(pixels, width, height, out);
+    std::vector<unsigned char> rgba;
+    int w = 0, h = 0;
+    bool same = decodeQoi(out, w, h, rgba) && w == width && h == height;
+    for (int y = 0; same && y < height; y++) {
+        const unsigned char* row = pixels + (size_t)(height - 1 - y) * stride;
+        for (int x = 0; same && x < width; x++) {
+            const unsigned char* q = &rgba[((size_t)y * width + x) * 4];
+            same = q[0] == row[x * 3] && q[1] == row[x * 3 + 1] && q[2] == row[x * 3 + 2] && q[3] == 255;
+        }
+    }
+    printf("  QOI round trip: %s\n", same ? "identical" : "MISMATCH");
+}
@@ -0,0 +1,121 @@
+#include <cmath>
+#include <algorithm>
+
+#include "../inc/LargeField.hpp"
+#include "../inc/Profiler.hpp"
+
+void DensityGrid::toVertices(std::vector<TrajectoryVertex>& out) const {
+    out.clear();
+    const size_t voxels = (size_t)size * size * size;
+    uint32_t maxCount = 0;
+    for (size_t v = 0; v < voxels; v++) maxCount = std::max(maxCount, counts[v].load(std::memory_order_relaxed));
+    if (!maxCount) return;
+
+    float norm = 1.0f / std::log1p((float)maxCount);
+    float cell[3];
+    for (int a = 0; a < 3; a++) cell[a] = (max[a] - min[a]) / size;
+    size_t index = 0;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            for (int k = 0; k < size; k++, index++) {
+                uint32_t count = counts[index].load(std::memory_order_relaxed);
+                if (!count) continue;
+                out.push_back({min[0] + (i + 0.5f) * cell[0], min[1] + (j + 0.5f) * cell[1],
+                               min[2] + (k + 0.5f) * cell[2], std::log1p((float)count) * norm});
+            }
+        }
+    }
+}
+
+LargeFieldJob::LargeFieldJob(const IteratedMap& m, const FieldConfig& c, int gridSize)
+    : config(c), map(m.clone()) {
+    FieldConfig preview = config;
+    preview.resolution = std::min(config.resolution, 12);
+    preview.sampling = 0;  // the large field is always a lattice
+    Trajectories traj;
+    computeField(*map, preview, traj);
+    grid.size = gridSize;
+    for (int a = 0; a < 3; a++) {
+        float pad = std::max(0.1f * (traj.boundsMax[a] - traj.boundsMin[a]), 1e-3f);
+        grid.min[a] = traj.boundsMin[a] - pad;
+        grid.max[a] = traj.boundsMax[a] + pad;
+    }
+
+    size_t voxels = (size_t)gridSize * gridSize * gridSize;
+    grid.counts.reset(new std::atomic<uint32_t>[voxels]);
+    for (size_t v = 0; v < voxels; v++) grid.counts[v].store(0, std::memory_order_relaxed);
+
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned t = 0; t < threads; t++) workers.emplace_back(&LargeFieldJob::workerLoop, this);
+}
+
+LargeFieldJob::~LargeFieldJob() {
+    cancelled = true;
+    for (std::thread& t : workers) t.join();
+}
+
+const DensityGrid& LargeFieldJob::result() {
+    return grid;
+}
+
+void LargeFieldJob::workerLoop() {
+    Profiler::setThreadName("large field");
+    std::unique_ptr<IteratedMap> m = map->clone();
+    const float scale = m->getScale();
+    const int res = config.resolution, size = grid.size;
+    float step = (config.range * 2.0f) / (float)(res > 1 ? res - 1 : 1);
+    float toCell[3];
+    for (int a = 0; a < 3; a++) toCell[a] = size / (grid.max[a] - grid.min[a]);
+
+    // Same seeds and vertices as computeField, reduced to voxel visits on the fly
+    auto visit = [&](const float p[3]) {
+        int v[3];
+        bool inside = true;
+        for (int a = 0; a < 3 && inside; a++) {
+            float f = (p[a] - grid.min[a]) * toCell[a];
+            inside = f >= 0.0f && f < (float)size;  // also false for NaN
+            v[a] = inside ? std::min((int)f, size - 1) : 0;
+        }
+        if (inside) grid.counts[((size_t)v[0] * size + v[1]) * size + v[2]].fetch_add(1, std::memory_order_relaxed);
+    };
+    TraceBatch batch;
+    batch.reserve(config.iterations);
+
+    for (;;) {
+        int i = nextSlab++;
+        if (i >= res || cancelled) return;
+        ProfileZone zone("slab");
+        for (int j = 0; j < res && !cancelled; j++) {
+            // Rows of seeds go through the map's batched kernel when it has one
+            for (int k0 = 0; k0 < res; k0 += KERNEL_LANES) {
+                batch.lanes = std::min(KERNEL_LANES, res - k0);
+                for (int l = 0; l < KERNEL_LANES; l++) {
+                    int k = k0 + std::min(l, batch.lanes - 1);
+                    batch.x[l] = (config.cx - config.range + (i * step)) * scale;
+                    batch.y[l] = (config.cy - config.range + (j * step)) * scale;
+                    batch.z[l] = (config.cz - config.range + (k * step)) * scale;
+                }
+                if (m->trace(batch)) {
+                    for (int l = 0; l < batch.lanes; l++) {
+                        for (int n = 0; n < batch.steps[l]; n++) {
+                            size_t at = (size_t)n * KERNEL_LANES + l;
+                            const float p[3] = {batch.px[at] / scale, batch.py[at] / scale, batch.pz[at] / scale};
+                            visit(p);
+                        }
+                    }
+                    continue;
+                }
+                for (int l = 0; l < batch.lanes; l++) {
+                    float x = batch.x[l], y = batch.y[l], z = batch.z[l];
+                    for (int n = 0; n < config.iterations; n++) {
+                        const float p[3] = {x / scale, y / scale, z / scale};
+                        m->iterate(x, y, z);
+                        visit(p);
+                        if (m->hasEscaped(x, y, z)) break;
+                    }
+                }
+            }
+        }
+        slabsDone++;
+    }
+}
@@ -0,0 +1,97 @@
+#include <atomic>
+#include <cstddef>
+
+#include "../inc/MapKernels.hpp"
+
+#if defined(__x86_64__)
+#define X86_KERNELS
+// Variants built from MapKernelsImpl.hpp with their own instruction set flags
+namespace sse2 {
+void traceHenon(const HenonParams& params, const TraceArrays& arrays);
+void traceLorenz(const LorenzParams& params, const TraceArrays& arrays);
+}
+namespace avx2 {
+void traceHenon(const HenonParams& params, const TraceArrays& arrays);
+void traceLorenz(const LorenzParams& params, const TraceArrays& arrays);
+}
+namespace avx512 {
+void traceHenon(const HenonParams& params, const TraceArrays& arrays);
+void traceLorenz(const LorenzParams& params, const TraceArrays& arrays);
+}
+#endif
+
+namespace {
+
+struct KernelTable {
+    void (*henon)(const HenonParams&, const TraceArrays&);
+    void (*lorenz)(const LorenzParams&, const TraceArrays&);
+};
+
+#ifdef X86_KERNELS
+const KernelTable tables[ISA_COUNT] = {
+    {nullptr, nullptr},
+    {sse2::traceHenon, sse2::traceLorenz},
+    {avx2::traceHenon, avx2::traceLorenz},
+    {avx512::traceHenon, avx512::traceLorenz},
+};
+#else
+const KernelTable tables[ISA_COUNT] = {};
+#endif
+
+int bestIsa() {
+    for (int isa = ISA_COUNT - 1; isa > ISA_SCALAR; isa--)
+        if (isaSupported(isa)) return isa;
+    return ISA_SCALAR;
+}
+
+std::atomic<int> active{bestIsa()};
+
+}  // namespace
+
+const char* isaName(int isa) {
+    static const char* names[ISA_COUNT] = {"scalar", "sse2", "avx2", "avx512"};
+    return isa >= 0 && isa < ISA_COUNT ? names[isa] : "?";
+}
+
+bool isaSupported(int isa) {
+    if (isa == ISA_SCALAR) return true;
+#ifdef X86_KERNELS
+    // __builtin_cpu_supports also checks that the OS saves the wide registers (XGETBV); init is
+    // needed when called from a static initializer
+    __builtin_cpu_init();
+    if (isa == ISA_SSE2) return true;
+    if (isa == ISA_AVX2) return __builtin_cpu_supports("avx2");
+    if (isa == ISA_AVX512) return __builtin_cpu_supports("avx512f");
+#endif
+    return false;
+}
+
+int activeIsa() {
+    return active.load(std::memory_order_relaxed);
+}
+
+bool selectIsa(int isa) {
+    if (isa < 0 || isa >= ISA_COUNT || !isaSupported(isa)) return false;
+    active.store(isa, std::memory_order_relaxed);
+    return true;
+}
+
+void TraceBatch::reserve(int iterationCount) {
+    iterations = iterationCount;
+    size_t size = (size_t)(iterationCount + 1) * KERNEL_LANES;
+    px.resize(size);
+    py.resize(size);
+    pz.resize(size);
+}
+
+static TraceArrays arrays(TraceBatch& batch) {
+    return {batch.iterations, batch.x, batch.y, batch.z, batch.px.data(), batch.py.data(), batch.pz.data(), batch.steps};
+}
+
+void traceHenon(const HenonParams& params, TraceBatch& batch) {
+    tables[activeIsa()].henon(params, arrays(batch));
+}
+
+void traceLorenz(const LorenzParams& params, TraceBatch& batch) {
+    tables[activeIsa()].lorenz(params, arrays(batch));
+}
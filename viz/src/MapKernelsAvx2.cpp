@@ -0,0 +1,3 @@
+// AVX2 (-mavx2) build of the map kernels, see CMakeLists.txt
+#define KERNEL_VARIANT avx2
+#include "../inc/MapKernelsImpl.hpp"
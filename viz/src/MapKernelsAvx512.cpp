@@ -0,0 +1,3 @@
+// AVX-512 (-mavx512f) build of the map kernels, see CMakeLists.txt
+#define KERNEL_VARIANT avx512
+#include "../inc/MapKernelsImpl.hpp"
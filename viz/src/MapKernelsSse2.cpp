@@ -0,0 +1,3 @@
+// SSE2 (the x86-64 baseline) build of the map kernels, see CMakeLists.txt
+#define KERNEL_VARIANT sse2
+#include "../inc/MapKernelsImpl.hpp"
@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "../inc/PerfCounters.hpp"
+
+static long long nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PerfCounters::PerfCounters() {
+    for (int& fd : fds) fd = -1;
+#ifdef __linux__
+    const unsigned long long configs[COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_REFERENCES,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[c];
+        attr.disabled = 1;
+        attr.inherit = 1;  // threads started while counting (e.g. simplification workers) add up
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fds[c] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fds[c] < 0 && error.empty()) {
+            if (errno == EACCES || errno == EPERM) error = "not permitted, see /proc/sys/kernel/perf_event_paranoid";
+            else if (errno == ENOENT || errno == EOPNOTSUPP) error = "not supported by this CPU or hypervisor";
+            else error = strerror(errno);
+        }
+    }
+#else
+    error = "perf_event_open needs Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int fd : fds) if (fd >= 0) close(fd);
+#endif
+}
+
+bool PerfCounters::anyAvailable() const {
+    for (int fd : fds) if (fd >= 0) return true;
+    return false;
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+    for (int fd : fds) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+    startNs = nowNs();
+}
+
+void PerfCounters::stop() {
+    seconds = (nowNs() - startNs) / 1e9;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        values[c] = 0;
+#ifdef __linux__
+        if (fds[c] < 0) continue;
+        ioctl(fds[c], PERF_EVENT_IOC_DISABLE, 0);
+        unsigned long long data[3];  // value, time enabled, time running
+        if (read(fds[c], data, sizeof(data)) != sizeof(data) || !data[2]) continue;
+        values[c] = (double)data[0] * ((double)data[1] / (double)data[2]);
+#endif
+    }
+}
+
+std::string PerfCounters::summary() const {
+    if (!anyAvailable()) return "no hardware counters (" + error + ")";
+    char text[160];
+    std::string out;
+    if (available(CYCLES) && available(INSTRUCTIONS) && values[CYCLES] > 0) {
+        snprintf(text, sizeof(text), "IPC %.2f, ", values[INSTRUCTIONS] / values[CYCLES]);
+        out += text;
+    }
+    if (available(CYCLES)) {
+        snprintf(text, sizeof(text), "%.3g G cycles", values[CYCLES] / 1e9);
+        out += text;
+    }
+    if (available(CACHE_MISSES) && available(CACHE_REFERENCES) && values[CACHE_REFERENCES] > 0) {
+        snprintf(text, sizeof(text), ", %.1f%% cache misses", 100.0 * values[CACHE_MISSES] / values[CACHE_REFERENCES]);
+        out += text;
+    }
+    if (available(BRANCH_MISSES) && available(BRANCHES) && values[BRANCHES] > 0) {
+        snprintf(text, sizeof(text), ", %.2f%% branch misses", 100.0 * values[BRANCH_MISSES] / values[BRANCHES]);
+        out += text;
+    }
+    return out;
+}
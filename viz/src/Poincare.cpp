@@ -0,0 +1,167 @@
+#include <cmath>
+#include <algorithm>
+
+#include "../inc/Poincare.hpp"
+#include "../inc/Colormap.hpp"
+#include "../inc/Seeding.hpp"
+#include "../inc/Profiler.hpp"
+
+void PoincareHistogram::toImage(int colormap, std::vector<unsigned char>& rgb) const {
+    std::vector<unsigned char> lut;
+    buildColormap(colormap, lut);
+    rgb.assign((size_t)size * size * 3, 0);
+    uint32_t maxCount = 0;
+    for (uint32_t c : counts) maxCount = std::max(maxCount, c);
+    if (!maxCount) return;
+
+    float norm = 1.0f / std::log1p((float)maxCount);
+    for (size_t i = 0; i < counts.size(); i++) {
+        if (!counts[i]) continue;
+        int entry = std::min(COLORMAP_SIZE - 1, (int)(std::log1p((float)counts[i]) * norm * (COLORMAP_SIZE - 1)));
+        for (int c = 0; c < 3; c++) rgb[i * 3 + c] = lut[entry * 3 + c];
+    }
+}
+
+PoincareJob::PoincareJob(const IteratedMap& m, const FieldConfig& field, const PoincareConfig& c)
+    : config(c), map(m.clone()) {
+    // Seeds of the field, in map space
+    generateSeeds(*map, field, seeds);
+    for (float& s : seeds) s *= map->getScale();
+    const size_t seedCount = seeds.size() / 3;
+
+    // Preview: a few seeds for a short time, scalar
+    float lo[2] = {INFINITY, INFINITY}, hi[2] = {-INFINITY, -INFINITY};
+    long long previewIterations = std::min(config.iterations, (long long)config.transient + 5000);
+    for (size_t s = 0; s < std::min(seedCount, (size_t)KERNEL_LANES); s++) {
+        float p[3] = {seeds[s * 3], seeds[s * 3 + 1], seeds[s * 3 + 2]};
+        for (long long n = 0; n < previewIterations; n++) {
+            float q[3] = {p[0], p[1], p[2]};
+            map->iterate(q[0], q[1], q[2]);
+            float u, w;
+            if (n >= config.transient && crossing(p, q, u, w)) {
+                lo[0] = std::min(lo[0], u); hi[0] = std::max(hi[0], u);
+                lo[1] = std::min(lo[1], w); hi[1] = std::max(hi[1], w);
+            }
+            if (map->hasEscaped(q[0], q[1], q[2])) break;
+            for (int a = 0; a < 3; a++) p[a] = q[a];
+        }
+    }
+    snapshot.size = config.size;
+    for (int a = 0; a < 2; a++) {
+        if (lo[a] > hi[a]) { lo[a] = -map->getScale(); hi[a] = map->getScale(); }
+        float pad = std::max(0.1f * (hi[a] - lo[a]), 1e-3f);
+        snapshot.min[a] = lo[a] - pad;
+        snapshot.max[a] = hi[a] + pad;
+    }
+
+    size_t cells = (size_t)config.size * config.size;
+    counts.reset(new std::atomic<uint32_t>[cells]);
+    for (size_t i = 0; i < cells; i++) counts[i].store(0, std::memory_order_relaxed);
+
+    blocks = (int)((seedCount + KERNEL_LANES - 1) / KERNEL_LANES);
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned t = 0; t < threads; t++) workers.emplace_back(&PoincareJob::workerLoop, this);
+}
+
+PoincareJob::~PoincareJob() {
+    cancelled = true;
+    for (std::thread& t : workers) t.join();
+}
+
+const PoincareHistogram& PoincareJob::histogram() {
+    size_t cells = (size_t)snapshot.size * snapshot.size;
+    snapshot.counts.resize(cells);
+    for (size_t i = 0; i < cells; i++) snapshot.counts[i] = counts[i].load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+bool PoincareJob::crossing(const float* p, const float* q, float& u, float& w) const {
+    const int a = config.axis, b = (a + 1) % 3, c = (a + 2) % 3;
+    if (!(p[a] < config.value && q[a] >= config.value)) return false;
+    float t = (config.value - p[a]) / (q[a] - p[a]);
+    u = p[b] + t * (q[b] - p[b]);
+    w = p[c] + t * (q[c] - p[c]);
+    return true;
+}
+
+void PoincareJob::accumulate(float u, float w) {
+    crossingCount.fetch_add(1, std::memory_order_relaxed);
+    const int size = snapshot.size;
+    float fu = (u - snapshot.min[0]) / (snapshot.max[0] - snapshot.min[0]) * size;
+    float fw = (w - snapshot.min[1]) / (snapshot.max[1] - snapshot.min[1]) * size;
+    if (!(fu >= 0.0f && fu < (float)size && fw >= 0.0f && fw < (float)size)) return;  // also false for NaN
+    counts[(size_t)std::min((int)fw, size - 1) * size + std::min((int)fu, size - 1)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void PoincareJob::workerLoop() {
+    Profiler::setThreadName("poincare");
+    std::unique_ptr<IteratedMap> m = map->clone();
+    const size_t seedCount = seeds.size() / 3;
+    // Iterations traced per kernel call: only these positions are kept at a time
+    const long long chunk = 256;
+    TraceBatch batch;
+
+    for (;;) {
+        int block = nextBlock++;
+        if (block >= blocks || cancelled) return;
+        ProfileZone zone("section");
+        size_t first = (size_t)block * KERNEL_LANES;
+        batch.lanes = (int)std::min((size_t)KERNEL_LANES, seedCount - first);
+        bool alive[KERNEL_LANES];
+        for (int l = 0; l < KERNEL_LANES; l++) {
+            size_t seed = first + std::min(l, batch.lanes - 1);
+            batch.x[l] = seeds[seed * 3];
+            batch.y[l] = seeds[seed * 3 + 1];
+            batch.z[l] = seeds[seed * 3 + 2];
+            alive[l] = l < batch.lanes;
+        }
+
+        int living = batch.lanes;
+        for (long long n0 = 0; n0 < config.iterations && living && !cancelled; n0 += chunk) {
+            batch.reserve((int)std::min(chunk, config.iterations - n0));
+            if (m->trace(batch)) {
+                for (int l = 0; l < batch.lanes; l++) {
+                    if (!alive[l]) continue;
+                    for (int n = std::max(0, (int)(config.transient - n0)); n < batch.steps[l]; n++) {
+                        size_t i = (size_t)n * KERNEL_LANES + l, j = i + KERNEL_LANES;
+                        const float p[3] = {batch.px[i], batch.py[i], batch.pz[i]};
+                        const float q[3] = {batch.px[j], batch.py[j], batch.pz[j]};
+                        float u, w;
+                        if (crossing(p, q, u, w)) accumulate(u, w);
+                    }
+                    // Continue from the last position, unless the lane escaped
+                    size_t last = (size_t)batch.iterations * KERNEL_LANES + l;
+                    batch.x[l] = batch.px[last];
+                    batch.y[l] = batch.py[last];
+                    batch.z[l] = batch.pz[last];
+                    if (batch.steps[l] < batch.iterations || m->hasEscaped(batch.x[l], batch.y[l], batch.z[l])) {
+                        alive[l] = false;
+                        living--;
+                    }
+                }
+                continue;
+            }
+
+            for (int l = 0; l < batch.lanes; l++) {
+                if (!alive[l]) continue;
+                float p[3] = {batch.x[l], batch.y[l], batch.z[l]};
+                for (long long n = n0; n < n0 + batch.iterations; n++) {
+                    float q[3] = {p[0], p[1], p[2]};
+                    m->iterate(q[0], q[1], q[2]);
+                    float u, w;
+                    if (n >= config.transient && crossing(p, q, u, w)) accumulate(u, w);
+                    for (int a = 0; a < 3; a++) p[a] = q[a];
+                    if (m->hasEscaped(p[0], p[1], p[2])) {
+                        alive[l] = false;
+                        living--;
+                        break;
+                    }
+                }
+                batch.x[l] = p[0];
+                batch.y[l] = p[1];
+                batch.z[l] = p[2];
+            }
+        }
+        blocksDone++;
+    }
+}
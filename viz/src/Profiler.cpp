@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../inc/Profiler.hpp"
+
+std::atomic<bool> Profiler::recording{false};
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start, end;
+};
+
+// Events of one thread, appended by that thread only. Chunks are never moved or freed, so the writer
+// can read events [0, count) while the thread keeps appending.
+struct ThreadTrace {
+    static constexpr size_t CHUNK = 4096, MAX_CHUNKS = 4096;  // up to 16M events per thread
+
+    int id = 0;
+    std::atomic<const char*> name{nullptr};
+    std::atomic<size_t> count{0};
+    std::unique_ptr<TraceEvent[]> chunks[MAX_CHUNKS];
+};
+
+// Every thread that recorded something; only locked when a thread records its first event
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadTrace>> registry;
+std::string tracePath;
+
+ThreadTrace& threadTrace() {
+    thread_local ThreadTrace* trace = nullptr;
+    if (!trace) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.push_back(std::make_unique<ThreadTrace>());
+        trace = registry.back().get();
+        trace->id = (int)registry.size();
+    }
+    return *trace;
+}
+
+}  // namespace
+
+void Profiler::start(const std::string& path) {
+    tracePath = path;
+    recording.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(const char* name) {
+    // Not recording: no trace buffer for this thread (workers come and go with every G / P)
+    if (!enabled()) return;
+    threadTrace().name.store(name, std::memory_order_relaxed);
+}
+
+uint64_t Profiler::now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end) {
+    ThreadTrace& trace = threadTrace();
+    size_t n = trace.count.load(std::memory_order_relaxed);
+    size_t chunk = n / ThreadTrace::CHUNK;
+    if (chunk >= ThreadTrace::MAX_CHUNKS) return;  // full: later events are dropped
+    if (!trace.chunks[chunk]) trace.chunks[chunk].reset(new TraceEvent[ThreadTrace::CHUNK]);
+    trace.chunks[chunk][n % ThreadTrace::CHUNK] = {name, start, end};
+    trace.count.store(n + 1, std::memory_order_release);
+}
+
+bool Profiler::write() {
+    if (!enabled()) return false;
+    FILE* f = fopen(tracePath.c_str(), "w");
+    if (!f) {
+        printf("Failed to write trace: %s\n", tracePath.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    // Timestamps relative to the earliest event, in microseconds
+    uint64_t origin = UINT64_MAX;
+    size_t events = 0;
+    for (const auto& trace : registry) {
+        size_t n = trace->count.load(std::memory_order_acquire);
+        if (n) origin = std::min(origin, trace->chunks[0][0].start);
+        events += n;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    bool first = true;
+    for (const auto& trace : registry) {
+        const char* name = trace->name.load(std::memory_order_relaxed);
+        fprintf(f, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s %d\"}}",
+                first ? "" : ",\n", trace->id, name ? name : "thread", trace->id);
+        first = false;
+        size_t n = trace->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; i++) {
+            const TraceEvent& e = trace->chunks[i / ThreadTrace::CHUNK][i % ThreadTrace::CHUNK];
+            fprintf(f, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                    e.name, trace->id, (e.start - origin) / 1e3, (e.end - e.start) / 1e3);
+        }
+    }
+    fprintf(f, "\n]}\n");
+    bool ok = fclose(f) == 0;
+    if (ok) printf("Trace saved: %s (%zu events, %zu threads)\n", tracePath.c_str(), events, registry.size());
+    return ok;
+}
@@ -0,0 +1,296 @@
+#include <cmath>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <queue>
+#include <random>
+#include <unordered_map>
+
+#include "../inc/Seeding.hpp"
+#include "../inc/Trajectories.hpp"
+
+const char* samplingName(int sampling) {
+    static const char* names[SAMPLING_COUNT] = {"Lattice", "Halton", "Sobol", "Jittered", "Adaptive"};
+    return sampling >= 0 && sampling < SAMPLING_COUNT ? names[sampling] : "?";
+}
+
+// Radical inverse of i in the given base
+static float halton(uint32_t i, uint32_t base) {
+    float f = 1.0f, r = 0.0f;
+    for (; i; i /= base) {
+        f /= base;
+        r += f * (i % base);
+    }
+    return r;
+}
+
+// Unit-cube points of the 3D Sobol sequence, generated in Gray code order
+static void sobol(int count, std::vector<float>& unit) {
+    // Direction numbers: van der Corput, then Joe-Kuo (s=1, a=0, m={1}) and (s=2, a=1, m={1, 3})
+    uint32_t v[3][32];
+    for (int i = 0; i < 32; i++) v[0][i] = 1u << (31 - i);
+    v[1][0] = 1u << 31;
+    for (int i = 1; i < 32; i++) v[1][i] = v[1][i - 1] ^ (v[1][i - 1] >> 1);
+    v[2][0] = 1u << 31;
+    v[2][1] = 3u << 30;
+    for (int i = 2; i < 32; i++) v[2][i] = v[2][i - 2] ^ (v[2][i - 2] >> 2) ^ v[2][i - 1];
+
+    uint32_t x[3] = {0, 0, 0};
+    // Skip the first point (the cube's corner)
+    for (uint32_t n = 1; (int)(unit.size() / 3) < count; n++) {
+        int c = 0;
+        while ((n - 1) >> c & 1) c++;
+        for (int d = 0; d < 3; d++) {
+            x[d] ^= v[d][c];
+            unit.push_back(x[d] * (1.0f / 4294967296.0f));
+        }
+    }
+}
+
+// Where the trajectory of a seed ends up (visualization space), or that it escaped
+struct SeedFate {
+    float end[3];
+    bool escaped;
+};
+
+// Cube of the adaptive grid: corner at integer coordinates (i, j, k) of the finest lattice, edge `size`
+struct RefineCell {
+    int i, j, k, size;
+    float score;
+    // Most divergent first, larger cells first among equals
+    bool operator<(const RefineCell& o) const { return score < o.score || (score == o.score && size < o.size); }
+};
+
+// Coarse resolution^3 lattice whose cells are recursively split in 8 where the trajectories of their
+// corners separate: some corners escape and others do not, or their end points lie further apart
+// than DIVERGENCE times the extent of the field's end points. Cells are split one level at a time,
+// the most divergent first (the last level splits what refineBudget seeds allow), down to
+// refineDepth levels. Corners shared by cells are only seeded once, so the seeds are the nodes of a
+// lattice of resolution (resolution - 1) * 2^refineDepth + 1 that only exists around the boundaries
+// between fates. The seeds of each level are traced together with the map's kernels into traced,
+// which ends up holding the field's trajectories in seed order.
+static void adaptiveSeeds(IteratedMap& map, const FieldConfig& config, std::vector<float>& xyz, Trajectories& traced) {
+    const float DIVERGENCE = 0.25f;
+    const int cells = std::max(1, config.resolution - 1), depth = std::clamp(config.refineDepth, 0, 10);
+    const int64_t nodesPerAxis = (int64_t)cells * (1 << depth) + 1;
+    const float step = config.range * 2.0f / (float)(nodesPerAxis - 1);
+    const float origin[3] = {config.cx - config.range, config.cy - config.range, config.cz - config.range};
+
+    std::unordered_map<int64_t, int> nodes;  // finest lattice index -> seed index
+    std::vector<SeedFate> fates;
+    auto node = [&](int i, int j, int k) {
+        int64_t key = ((int64_t)i * nodesPerAxis + j) * nodesPerAxis + k;
+        auto it = nodes.find(key);
+        if (it != nodes.end()) return it->second;
+        int index = (int)(xyz.size() / 3);
+        xyz.insert(xyz.end(), {origin[0] + i * step, origin[1] + j * step, origin[2] + k * step});
+        nodes.emplace(key, index);
+        return index;
+    };
+    // Trace the seeds added since the last call, all at once
+    std::vector<float> ends;
+    auto trace = [&]() {
+        size_t first = fates.size(), count = xyz.size() / 3 - first;
+        ends.resize(count * 3);
+        traceField(map, xyz.data() + first * 3, count, config.iterations, traced, ends.data());
+        for (size_t t = 0; t < count; t++) {
+            const float* e = &ends[t * 3];
+            fates.push_back({{e[0], e[1], e[2]}, std::isnan(e[0])});
+        }
+    };
+
+    const int size = 1 << depth;
+    for (int i = 0; i <= cells; i++)
+        for (int j = 0; j <= cells; j++)
+            for (int k = 0; k <= cells; k++) node(i * size, j * size, k * size);
+    trace();
+    if (!depth) return;
+
+    // Divergence threshold, from the extent of the coarse end points
+    float lo[3] = {INFINITY, INFINITY, INFINITY}, hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (const SeedFate& fate : fates) {
+        if (fate.escaped) continue;
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::min(lo[a], fate.end[a]);
+            hi[a] = std::max(hi[a], fate.end[a]);
+        }
+    }
+    float extent = 0.0f;
+    for (int a = 0; a < 3; a++) extent += hi[a] > lo[a] ? (hi[a] - lo[a]) * (hi[a] - lo[a]) : 0.0f;
+    const float threshold = DIVERGENCE * DIVERGENCE * extent;
+
+    // Squared spread of the corner end points (all traced), infinite if only some corners escape, 0 if below threshold
+    auto score = [&](int i, int j, int k, int s) {
+        int escaped = 0;
+        float cmin[3] = {INFINITY, INFINITY, INFINITY}, cmax[3] = {-INFINITY, -INFINITY, -INFINITY};
+        for (int c = 0; c < 8; c++) {
+            const SeedFate& fate = fates[node(i + (c >> 2 & 1) * s, j + (c >> 1 & 1) * s, k + (c & 1) * s)];
+            escaped += fate.escaped;
+            if (fate.escaped) continue;
+            for (int a = 0; a < 3; a++) {
+                cmin[a] = std::min(cmin[a], fate.end[a]);
+                cmax[a] = std::max(cmax[a], fate.end[a]);
+            }
+        }
+        if (escaped == 8) return 0.0f;
+        if (escaped) return INFINITY;
+        float spread = 0.0f;
+        for (int a = 0; a < 3; a++) spread += (cmax[a] - cmin[a]) * (cmax[a] - cmin[a]);
+        return spread > threshold ? spread : 0.0f;
+    };
+
+    std::priority_queue<RefineCell> queue;
+    auto push = [&](int i, int j, int k, int s) {
+        float sc = score(i, j, k, s);
+        if (sc > 0.0f) queue.push({i, j, k, s, sc});
+    };
+    for (int i = 0; i < cells; i++)
+        for (int j = 0; j < cells; j++)
+            for (int k = 0; k < cells; k++) push(i * size, j * size, k * size, size);
+
+    // A split adds at most 19 seeds (edge midpoints, face centers and the cell center); its children
+    // are scored once the whole level is traced
+    std::vector<RefineCell> children;
+    while (!queue.empty() && (int)(xyz.size() / 3) + 19 <= config.refineBudget) {
+        children.clear();
+        while (!queue.empty() && (int)(xyz.size() / 3) + 19 <= config.refineBudget) {
+            RefineCell cell = queue.top();
+            queue.pop();
+            const int h = cell.size / 2;
+            for (int n = 0; n < 27; n++) node(cell.i + n / 9 * h, cell.j + n / 3 % 3 * h, cell.k + n % 3 * h);
+            if (h > 1)
+                for (int c = 0; c < 8; c++)
+                    children.push_back({cell.i + (c >> 2 & 1) * h, cell.j + (c >> 1 & 1) * h, cell.k + (c & 1) * h, h, 0.0f});
+        }
+        trace();
+        for (const RefineCell& child : children) push(child.i, child.j, child.k, child.size);
+    }
+}
+
+void generateSeeds(IteratedMap& map, const FieldConfig& config, std::vector<float>& xyz, Trajectories* traced) {
+    xyz.clear();
+    if (config.sampling == SAMPLING_ADAPTIVE) {
+        // Kept per thread when the caller only wants the seeds, so recomputing does not allocate
+        thread_local Trajectories scratch;
+        if (!traced) {
+            scratch.clear();
+            traced = &scratch;
+        }
+        adaptiveSeeds(map, config, xyz, *traced);
+        return;
+    }
+    if (config.sampling == SAMPLING_LATTICE) {
+        const int res = config.resolution;
+        float step = (config.range * 2.0f) / (float)(res > 1 ? res - 1 : 1);
+        xyz.reserve((size_t)res * res * res * 3);
+        for (int i = 0; i < res; i++)
+            for (int j = 0; j < res; j++)
+                for (int k = 0; k < res; k++)
+                    xyz.insert(xyz.end(), {config.cx - config.range + (i * step),
+                                           config.cy - config.range + (j * step),
+                                           config.cz - config.range + (k * step)});
+        return;
+    }
+
+    // Other strategies fill the unit cube, then get scaled to the field cube
+    const int count = std::max(1, config.seedCount);
+    std::vector<float> unit;
+    unit.reserve((size_t)count * 3);
+    if (config.sampling == SAMPLING_HALTON) {
+        for (int i = 1; i <= count; i++) unit.insert(unit.end(), {halton(i, 2), halton(i, 3), halton(i, 5)});
+    } else if (config.sampling == SAMPLING_SOBOL) {
+        sobol(count, unit);
+    } else {
+        std::mt19937 rng(12345);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        int k = (int)std::cbrt((double)count + 0.5);
+        for (int i = 0; i < k; i++)
+            for (int j = 0; j < k; j++)
+                for (int l = 0; l < k; l++)
+                    unit.insert(unit.end(), {(i + uniform(rng)) / k, (j + uniform(rng)) / k, (l + uniform(rng)) / k});
+        while ((int)(unit.size() / 3) < count) unit.insert(unit.end(), {uniform(rng), uniform(rng), uniform(rng)});
+    }
+
+    const float center[3] = {config.cx, config.cy, config.cz};
+    xyz.resize(unit.size());
+    for (size_t i = 0; i < unit.size(); i++) xyz[i] = center[i % 3] - config.range + unit[i] * 2.0f * config.range;
+}
+
+// Share of a size^2 grid covered by the vertices projected along each axis, averaged over the
+// three axes: what the trajectories fill on screen when viewed along x, y or z
+static float projectedCoverage(const Trajectories& traj, const float min[3], const float max[3], int size,
+                               std::vector<char>& hit) {
+    float total = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        hit.assign((size_t)size * size, 0);
+        int covered = 0;
+        for (const TrajectoryVertex& vertex : traj.vertices) {
+            const float p[3] = {vertex.x, vertex.y, vertex.z};
+            float fu = (p[u] - min[u]) / (max[u] - min[u]) * size, fv = (p[v] - min[v]) / (max[v] - min[v]) * size;
+            if (!(fu >= 0.0f && fu < (float)size && fv >= 0.0f && fv < (float)size)) continue;
+            char& h = hit[(size_t)std::min((int)fu, size - 1) * size + std::min((int)fv, size - 1)];
+            covered += !h;
+            h = 1;
+        }
+        total += (float)covered / ((size_t)size * size);
+    }
+    return total / 3.0f;
+}
+
+void compareSampling(IteratedMap& map, const FieldConfig& config) {
+    const int GRID = 256;
+    // Coverage counts vertices, so they are all kept
+    FieldConfig unsimplified = config;
+    unsimplified.simplify = 0.0f;
+    // Bounds of a dense lattice over the same field, so every strategy is measured on the same grid
+    FieldConfig reference = unsimplified;
+    reference.sampling = SAMPLING_LATTICE;
+    reference.resolution = 40;
+    Trajectories traj;
+    computeField(map, reference, traj);
+    float min[3], max[3];
+    for (int a = 0; a < 3; a++) {
+        float pad = std::max(1e-3f, 0.01f * (traj.boundsMax[a] - traj.boundsMin[a]));
+        min[a] = traj.boundsMin[a] - pad;
+        max[a] = traj.boundsMax[a] + pad;
+    }
+    std::vector<char> hit;
+
+    printf("%s, %d iterations: share of a %dx%d grid covered by the trajectories projected along x, y and z\n",
+           map.getName(), config.iterations, GRID, GRID);
+    printf("%8s", "seeds");
+    for (int s = 0; s < SAMPLING_ADAPTIVE; s++) printf(" %9s", samplingName(s));
+    printf("\n");
+    for (int res : {5, 8, 10, 13, 16, 20, 25, 30, 40}) {
+        int count = res * res * res;
+        printf("%8d", count);
+        for (int s = 0; s < SAMPLING_ADAPTIVE; s++) {
+            FieldConfig c = unsimplified;
+            c.sampling = s;
+            c.resolution = res;
+            c.seedCount = count;
+            computeField(map, c, traj);
+            printf(" %8.1f%%", 100.0f * projectedCoverage(traj, min, max, GRID, hit));
+        }
+        printf("\n");
+    }
+
+    // Adaptive seeding has no seed count of its own: show what refining every boundary down to each
+    // depth costs (no budget) against the lattice it matches along the boundaries
+    printf("\nAdaptive from a %d^3 lattice:\n%6s %8s %12s %14s %9s\n", config.resolution,
+           "depth", "seeds", "equivalent", "lattice seeds", "share");
+    std::vector<float> seeds;
+    for (int depth = 0; depth <= 5; depth++) {
+        FieldConfig c = config;
+        c.sampling = SAMPLING_ADAPTIVE;
+        c.refineDepth = depth;
+        c.refineBudget = INT_MAX;
+        generateSeeds(map, c, seeds);
+        long long equivalent = (long long)std::max(1, config.resolution - 1) * (1 << depth) + 1;
+        long long latticeSeeds = equivalent * equivalent * equivalent;
+        printf("%6d %8zu %10lld^3 %14lld %8.2f%%\n", depth, seeds.size() / 3, equivalent, latticeSeeds,
+               100.0 * (seeds.size() / 3) / latticeSeeds);
+    }
+}
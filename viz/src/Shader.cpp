@@ -0,0 +1,54 @@
+#include <iostream>
+#include <vector>
+
+#include "../inc/Shader.hpp"
+
+static GLuint compileShader(GLenum type, const char* src) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &src, NULL);
+    glCompileShader(shader);
+
+    GLint ok = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &len);
+        std::vector<char> log(len + 1);
+        glGetShaderInfoLog(shader, len, NULL, log.data());
+        std::cerr << "Shader compile error: " << log.data() << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint createProgram(const char* vertexSrc, const char* fragmentSrc, const char* const* attribs) {
+    GLuint vs = compileShader(GL_VERTEX_SHADER, vertexSrc);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragmentSrc);
+    if (!vs || !fs) {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    for (GLuint i = 0; attribs && attribs[i]; i++) glBindAttribLocation(program, i, attribs[i]);
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
+        std::vector<char> log(len + 1);
+        glGetProgramInfoLog(program, len, NULL, log.data());
+        std::cerr << "Shader link error: " << log.data() << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
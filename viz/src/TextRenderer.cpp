@@ -0,0 +1,152 @@
+#include <cmath>
+#include <algorithm>
+
+#include <GL/freeglut.h>
+#include <GL/glu.h>
+
+#include "../inc/TextRenderer.hpp"
+
+TextRenderer::TextRenderer(void* font) {
+    bake(font);
+    glGenBuffers(1, &vbo);
+}
+
+TextRenderer::~TextRenderer() {
+    glDeleteBuffers(1, &vbo);
+    glDeleteTextures(1, &atlas);
+}
+
+// Rasterize every glyph once with glutBitmapCharacter into the back buffer and read it back as a texture
+void TextRenderer::bake(void* font) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    atlasWidth = std::min(512, (int)viewport[2]);
+
+    cellHeight = glutBitmapHeight(font) + 1;
+    descent = cellHeight / 4;
+
+    // Pack glyph cells left to right, wrapping rows at the atlas width
+    int x = 0, y = 0;
+    for (int c = FIRST_CHAR; c <= LAST_CHAR; c++) {
+        int advance = glutBitmapWidth(font, c);
+        if (x + advance + 1 > atlasWidth) {
+            x = 0;
+            y += cellHeight;
+        }
+        glyphX[c - FIRST_CHAR] = x;
+        glyphY[c - FIRST_CHAR] = y;
+        glyphAdvance[c - FIRST_CHAR] = advance;
+        x += advance + 1;
+    }
+    atlasHeight = y + cellHeight;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glClearColor(0, 0, 0, 1);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glMatrixMode(GL_PROJECTION); glPushMatrix(); glLoadIdentity();
+    gluOrtho2D(0, viewport[2], 0, viewport[3]);
+    glMatrixMode(GL_MODELVIEW); glPushMatrix(); glLoadIdentity();
+    glColor3f(1.0f, 1.0f, 1.0f);
+    for (int c = FIRST_CHAR; c <= LAST_CHAR; c++) {
+        glRasterPos2i(glyphX[c - FIRST_CHAR], glyphY[c - FIRST_CHAR] + descent);
+        glutBitmapCharacter(font, c);
+    }
+    glPopMatrix(); glMatrixMode(GL_PROJECTION); glPopMatrix(); glMatrixMode(GL_MODELVIEW);
+
+    std::vector<unsigned char> pixels(atlasWidth * atlasHeight);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, atlasWidth, atlasHeight, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glClear(GL_COLOR_BUFFER_BIT);
+    glPopAttrib();
+
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA8, atlasWidth, atlasHeight, 0, GL_ALPHA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+TextRenderer::Entry& TextRenderer::entry(int id) {
+    if (id >= (int)entries.size()) entries.resize(id + 1);
+    return entries[id];
+}
+
+bool TextRenderer::changed(int id, std::initializer_list<double> key) {
+    Entry& e = entry(id);
+    if (e.key.size() == key.size() && std::equal(key.begin(), key.end(), e.key.begin())) return false;
+    e.key.assign(key.begin(), key.end());
+    return true;
+}
+
+void TextRenderer::setText(int id, float x, float y, const std::string& text) {
+    Entry& e = entry(id);
+    if (e.x == x && e.y == y && e.text == text) return;
+    e.x = x;
+    e.y = y;
+    e.text = text;
+    dirty = true;
+}
+
+// One textured quad (two triangles, x y u v per vertex) per visible character of every entry
+void TextRenderer::rebuild() {
+    std::vector<float> data;
+    for (const Entry& e : entries) {
+        float x = std::floor(e.x), baseline = std::floor(e.y);
+        for (char ch : e.text) {
+            int c = (unsigned char)ch;
+            if (c < FIRST_CHAR || c > LAST_CHAR) continue;
+            int g = c - FIRST_CHAR;
+            float w = (float)glyphAdvance[g];
+            float top = baseline - (cellHeight - descent), bottom = baseline + descent;
+            float u0 = (float)glyphX[g] / atlasWidth, u1 = (glyphX[g] + w) / atlasWidth;
+            // Atlas rows come from glReadPixels, so v grows upwards
+            float v0 = (float)glyphY[g] / atlasHeight, v1 = (float)(glyphY[g] + cellHeight) / atlasHeight;
+            data.insert(data.end(), {
+                x, top, u0, v1,   x + w, top, u1, v1,   x + w, bottom, u1, v0,
+                x, top, u0, v1,   x + w, bottom, u1, v0,   x, bottom, u0, v0,
+            });
+            x += w;
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vertexCount = (int)(data.size() / 4);
+    dirty = false;
+}
+
+void TextRenderer::draw(int fbWidth, int fbHeight) {
+    if (dirty) rebuild();
+    if (!vertexCount) return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+    glMatrixMode(GL_PROJECTION); glPushMatrix(); glLoadIdentity();
+    gluOrtho2D(0, fbWidth, fbHeight, 0);
+    glMatrixMode(GL_MODELVIEW); glPushMatrix(); glLoadIdentity();
+
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glColor3f(1.0f, 1.0f, 1.0f);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 4 * sizeof(float), (void*)0);
+    glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glPopMatrix(); glMatrixMode(GL_PROJECTION); glPopMatrix(); glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+}
@@ -0,0 +1,503 @@
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <functional>
+#include <thread>
+
+#include "../inc/Trajectories.hpp"
+#include "../inc/Seeding.hpp"
+#include "../inc/Profiler.hpp"
+#include "../inc/PerfCounters.hpp"
+#include "../inc/MapKernels.hpp"
+
+void Trajectories::clear() {
+    vertices.clear();
+    firsts.clear();
+    counts.clear();
+    // Levels stay allocated (empty) for buildLods to refill
+    for (LodLevel& lod : lods) {
+        lod.firsts.clear();
+        lod.counts.clear();
+        lod.errors.clear();
+        lod.chunks.clear();
+        lod.chunkStarts.clear();
+    }
+}
+
+// Distance from p to segment [a, b]
+static float segmentDistance(const TrajectoryVertex& p, const TrajectoryVertex& a, const TrajectoryVertex& b) {
+    float abx = b.x - a.x, aby = b.y - a.y, abz = b.z - a.z;
+    float apx = p.x - a.x, apy = p.y - a.y, apz = p.z - a.z;
+    float len2 = abx*abx + aby*aby + abz*abz;
+    float t = len2 > 0.0f ? std::clamp((apx*abx + apy*aby + apz*abz) / len2, 0.0f, 1.0f) : 0.0f;
+    float dx = apx - t*abx, dy = apy - t*aby, dz = apz - t*abz;
+    return std::sqrt(dx*dx + dy*dy + dz*dz);
+}
+
+static void setEnd(float* end, float x, float y, float z, float scale, bool escaped) {
+    if (escaped || !std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z)) x = y = z = NAN;
+    end[0] = x / scale;
+    end[1] = y / scale;
+    end[2] = z / scale;
+}
+
+// Trace seedCount seeds for each parameter value (one field per value, or only the map's own values
+// when there are none) into outs, after their trajectories if append. Seeds and values are
+// interleaved across kernel lanes. Without values, ends (if given) receives where each seed ends up
+// after all iterations (visualization space), NaN if it escaped.
+static void traceSeeds(IteratedMap& map, const float* seeds, size_t seedCount, int iterations, int param,
+                       const std::vector<float>& values, Trajectories* const* outs, bool append = false,
+                       float* ends = nullptr) {
+    const float scale = map.getScale();
+    const size_t members = std::max((size_t)1, values.size());
+    const size_t items = seedCount * members;
+
+    // Maps of the members, for the scalar path
+    std::vector<std::unique_ptr<IteratedMap>> memberMaps;
+    for (float value : values) {
+        memberMaps.push_back(map.clone());
+        memberMaps.back()->setParam(map.getParamNames()[param], value);
+    }
+
+    for (size_t m = 0; m < members; m++) {
+        Trajectories& out = *outs[m];
+        if (!append) out.clear();
+        out.vertices.reserve(out.vertices.size() + seedCount * iterations);
+        out.firsts.reserve(out.firsts.size() + seedCount);
+        out.counts.reserve(out.counts.size() + seedCount);
+    }
+
+    // Seeds go through the map's batched kernel KERNEL_LANES at a time when it has one
+    thread_local TraceBatch batch;
+    batch.reserve(iterations);
+    batch.variedParam = values.empty() ? -1 : param;
+    for (size_t q = 0; q < items; q += KERNEL_LANES) {
+        batch.lanes = (int)std::min((size_t)KERNEL_LANES, items - q);
+        for (int l = 0; l < KERNEL_LANES; l++) {
+            // Initial point in visualization space, scaled to map space (unused lanes repeat the last seed)
+            size_t item = q + std::min(l, batch.lanes - 1), seed = item / members;
+            batch.x[l] = seeds[seed * 3] * scale;
+            batch.y[l] = seeds[seed * 3 + 1] * scale;
+            batch.z[l] = seeds[seed * 3 + 2] * scale;
+            batch.paramValues[l] = values.empty() ? 0.0f : values[item % members];
+        }
+        if (map.trace(batch)) {
+            for (int l = 0; l < batch.lanes; l++) {
+                Trajectories& out = *outs[(q + l) % members];
+                int first = (int)out.vertices.size();
+                for (int n = 0; n < batch.steps[l]; n++) {
+                    size_t i = (size_t)n * KERNEL_LANES + l, j = i + KERNEL_LANES;
+                    float px = batch.px[i], py = batch.py[i], pz = batch.pz[i];
+                    float x = batch.px[j], y = batch.py[j], z = batch.pz[j];
+                    float dist = std::sqrt((x-px)*(x-px) + (y-py)*(y-py) + (z-pz)*(z-pz));
+                    out.vertices.push_back({px / scale, py / scale, pz / scale, dist / scale});
+                }
+                out.firsts.push_back(first);
+                out.counts.push_back((int)out.vertices.size() - first);
+                if (ends) {
+                    size_t j = (size_t)iterations * KERNEL_LANES + l;
+                    bool escaped = batch.steps[l] < iterations || map.hasEscaped(batch.px[j], batch.py[j], batch.pz[j]);
+                    setEnd(ends + (q + l) * 3, batch.px[j], batch.py[j], batch.pz[j], scale, escaped);
+                }
+            }
+            continue;
+        }
+
+        for (int l = 0; l < batch.lanes; l++) {
+            size_t member = (q + l) % members;
+            IteratedMap& memberMap = memberMaps.empty() ? map : *memberMaps[member];
+            Trajectories& out = *outs[member];
+            float x = batch.x[l], y = batch.y[l], z = batch.z[l];
+
+            int first = (int)out.vertices.size();
+            bool escaped = false;
+            for (int n = 0; n < iterations && !escaped; n++) {
+                float px = x, py = y, pz = z;
+                memberMap.iterate(x, y, z);
+
+                // dist is in map space, store it in visualization space for coloring
+                float dist = std::sqrt((x-px)*(x-px) + (y-py)*(y-py) + (z-pz)*(z-pz));
+                out.vertices.push_back({px / scale, py / scale, pz / scale, dist / scale});
+
+                escaped = memberMap.hasEscaped(x, y, z);
+            }
+            out.firsts.push_back(first);
+            out.counts.push_back((int)out.vertices.size() - first);
+            if (ends) setEnd(ends + (q + l) * 3, x, y, z, scale, escaped);
+        }
+    }
+}
+
+// Simplify a traced field and compute its bounds
+static void finishField(Trajectories& out, const FieldConfig& config) {
+    out.computedVertices = out.vertices.size();
+    {
+        ProfileZone zone("simplify");
+        simplifyTrajectories(out, config.simplify);
+    }
+    out.simplifiedVertices = out.vertices.size();
+
+    for (int a = 0; a < 3; a++) {
+        out.boundsMin[a] = out.vertices.empty() ? 0.0f : INFINITY;
+        out.boundsMax[a] = out.vertices.empty() ? 0.0f : -INFINITY;
+    }
+    for (const TrajectoryVertex& v : out.vertices) {
+        const float p[3] = {v.x, v.y, v.z};
+        for (int a = 0; a < 3; a++) {
+            out.boundsMin[a] = std::min(out.boundsMin[a], p[a]);
+            out.boundsMax[a] = std::max(out.boundsMax[a], p[a]);
+        }
+    }
+}
+
+void traceField(IteratedMap& map, const float* seeds, size_t count, int iterations, Trajectories& out, float* ends) {
+    Trajectories* outs[1] = {&out};
+    traceSeeds(map, seeds, count, iterations, -1, {}, outs, true, ends);
+}
+
+// Seeds are kept per thread so recomputing does not allocate
+static const std::vector<float>& fieldSeeds(IteratedMap& map, const FieldConfig& config, Trajectories* traced = nullptr) {
+    ProfileZone zone("seeds");
+    thread_local std::vector<float> seeds;
+    generateSeeds(map, config, seeds, traced);
+    return seeds;
+}
+
+void computeField(IteratedMap& map, const FieldConfig& config, Trajectories& out) {
+    ProfileZone zone("compute");
+    if (config.sampling == SAMPLING_ADAPTIVE) {
+        // Placing the seeds traced them already
+        out.clear();
+        fieldSeeds(map, config, &out);
+    } else {
+        const std::vector<float>& seeds = fieldSeeds(map, config);
+        Trajectories* outs[1] = {&out};
+        traceSeeds(map, seeds.data(), seeds.size() / 3, config.iterations, -1, {}, outs);
+    }
+    finishField(out, config);
+}
+
+void computeEnsemble(IteratedMap& map, const FieldConfig& config, int param, const std::vector<float>& values,
+                     const std::vector<Trajectories*>& out) {
+    ProfileZone zone("compute");
+    if (!values.empty()) {
+        const std::vector<float>& seeds = fieldSeeds(map, config);
+        traceSeeds(map, seeds.data(), seeds.size() / 3, config.iterations, param, values, out.data());
+    }
+    for (size_t m = 0; m < values.size(); m++) finishField(*out[m], config);
+}
+
+void computeEnsemble(IteratedMap& map, const FieldConfig& config, int param, const std::vector<float>& values,
+                     std::vector<Trajectories>& out) {
+    out.resize(values.size());
+    std::vector<Trajectories*> outs;
+    for (Trajectories& field : out) outs.push_back(&field);
+    computeEnsemble(map, config, param, values, outs);
+}
+
+bool loadOrbit(const std::string& path, float scale, Trajectories& out, long long maxPoints) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        printf("Could not open orbit %s\n", path.c_str());
+        return false;
+    }
+    fseeko(file, 0, SEEK_END);
+    long long points = (long long)ftello(file) / (long long)(3 * sizeof(float));
+    fseeko(file, 0, SEEK_SET);
+
+    // Every stride-th point, so that the vertices and their int offsets stay within budget
+    maxPoints = std::clamp(maxPoints, 2LL, (long long)INT_MAX);
+    long long stride = std::max(1LL, (points + maxPoints - 1) / maxPoints);
+    if (stride > 1)
+        printf("Orbit %s: %lld points, reading every %lld-th (--orbit-points %lld)\n", path.c_str(), points, stride, maxPoints);
+
+    out.clear();
+    out.vertices.reserve((size_t)std::min(points / stride + 1, maxPoints));
+    // Read in blocks; speed is the step to the next point kept, as in computeField
+    std::vector<float> block(3 << 16);
+    float previous[3];
+    bool first = true;
+    long long index = 0;
+    size_t read;
+    while ((read = fread(block.data(), sizeof(float) * 3, block.size() / 3, file)) > 0) {
+        for (size_t i = 0; i < read; i++, index++) {
+            if (index % stride != 0) continue;
+            const float* p = &block[i * 3];
+            if (!first) {
+                float dist = std::sqrt((p[0]-previous[0])*(p[0]-previous[0]) + (p[1]-previous[1])*(p[1]-previous[1]) + (p[2]-previous[2])*(p[2]-previous[2]));
+                out.vertices.push_back({previous[0] / scale, previous[1] / scale, previous[2] / scale, dist / scale});
+            }
+            for (int a = 0; a < 3; a++) previous[a] = p[a];
+            first = false;
+        }
+    }
+    fclose(file);
+    if (out.vertices.empty()) {
+        printf("Orbit %s has fewer than two points\n", path.c_str());
+        return false;
+    }
+    out.firsts.push_back(0);
+    out.counts.push_back((int)out.vertices.size());
+    FieldConfig unsimplified;
+    unsimplified.simplify = 0.0f;
+    finishField(out, unsimplified);
+    return true;
+}
+
+// Douglas-Peucker on trajectory [first, first + count): marks the vertices to keep. A vertex is
+// needed if it lies further than `tolerance` from the segment replacing it, or if its speed differs
+// by more than `speedTolerance` from the speed interpolated along that segment (what the shader draws).
+static void simplifyStrip(const Trajectories& traj, int first, int count, float tolerance, float speedTolerance,
+                          std::vector<uint8_t>& keep, std::vector<std::pair<int, int>>& stack) {
+    if (count <= 2) return;
+    stack.clear();
+    stack.push_back({first, first + count - 1});
+    while (!stack.empty()) {
+        auto [a, b] = stack.back();
+        stack.pop_back();
+        const TrajectoryVertex& va = traj.vertices[a];
+        const TrajectoryVertex& vb = traj.vertices[b];
+        float abx = vb.x - va.x, aby = vb.y - va.y, abz = vb.z - va.z;
+        float len2 = abx*abx + aby*aby + abz*abz;
+        int worst = -1;
+        float worstError = 1.0f;  // errors are normalized by their tolerance
+        for (int i = a + 1; i < b; i++) {
+            const TrajectoryVertex& p = traj.vertices[i];
+            float apx = p.x - va.x, apy = p.y - va.y, apz = p.z - va.z;
+            float t = len2 > 0.0f ? std::clamp((apx*abx + apy*aby + apz*abz) / len2, 0.0f, 1.0f) : 0.0f;
+            float dx = apx - t*abx, dy = apy - t*aby, dz = apz - t*abz;
+            float error = std::max(std::sqrt(dx*dx + dy*dy + dz*dz) / tolerance,
+                                   std::abs(p.speed - (va.speed + t * (vb.speed - va.speed))) / speedTolerance);
+            if (error > worstError) {
+                worstError = error;
+                worst = i;
+            }
+        }
+        if (worst < 0) continue;
+        keep[worst] = 1;
+        stack.push_back({a, worst});
+        stack.push_back({worst, b});
+    }
+}
+
+void simplifyTrajectories(Trajectories& traj, float tolerance) {
+    const int trajCount = traj.size();
+    if (tolerance <= 0.0f || !trajCount) return;
+    float maxSpeed = 0.0f;
+    for (const TrajectoryVertex& v : traj.vertices) maxSpeed = std::max(maxSpeed, v.speed);
+    // One step of the 8-bit speed of the quantized format
+    const float speedTolerance = std::max(maxSpeed / 255.0f, 1e-30f);
+
+    // Kept per thread so recomputing does not allocate
+    thread_local std::vector<uint8_t> keep;
+    keep.assign(traj.vertices.size(), 0);
+    for (int t = 0; t < trajCount; t++) {
+        if (!traj.counts[t]) continue;
+        keep[traj.firsts[t]] = 1;
+        keep[traj.firsts[t] + traj.counts[t] - 1] = 1;
+    }
+
+    // Trajectories are independent: threads take batches of them
+    std::atomic<int> next{0};
+    auto worker = [&]() {
+        std::vector<std::pair<int, int>> stack;
+        for (;;) {
+            int begin = next.fetch_add(256);
+            if (begin >= trajCount) return;
+            for (int t = begin; t < std::min(begin + 256, trajCount); t++)
+                simplifyStrip(traj, traj.firsts[t], traj.counts[t], tolerance, speedTolerance, keep, stack);
+        }
+    };
+    unsigned threadCount = std::min(std::max(1u, std::thread::hardware_concurrency()), (unsigned)(trajCount + 255) / 256);
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < threadCount; i++) threads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : threads) thread.join();
+
+    // Compact in place: kept vertices only move towards the front
+    size_t out = 0;
+    for (int t = 0; t < trajCount; t++) {
+        const int first = traj.firsts[t], count = traj.counts[t];
+        traj.firsts[t] = (int)out;
+        for (int i = first; i < first + count; i++)
+            if (keep[i]) traj.vertices[out++] = traj.vertices[i];
+        traj.counts[t] = (int)out - traj.firsts[t];
+    }
+    traj.vertices.resize(out);
+}
+
+// Split every strip of the level into chunks of CHUNK_VERTICES and compute their bounds
+static void buildChunks(const Trajectories& traj, LodLevel& lod) {
+    lod.chunks.clear();
+    lod.chunkStarts.assign(1, 0);
+    for (size_t t = 0; t < lod.firsts.size(); t++) {
+        int first = lod.firsts[t];
+        const int end = first + lod.counts[t];
+        while (first < end) {
+            TrajectoryChunk chunk;
+            chunk.first = first;
+            chunk.count = std::min(CHUNK_VERTICES, end - first);
+            for (int a = 0; a < 3; a++) {
+                chunk.min[a] = INFINITY;
+                chunk.max[a] = -INFINITY;
+            }
+            for (int i = first; i < first + chunk.count; i++) {
+                const TrajectoryVertex& v = traj.vertices[i];
+                const float p[3] = {v.x, v.y, v.z};
+                for (int a = 0; a < 3; a++) {
+                    chunk.min[a] = std::min(chunk.min[a], p[a]);
+                    chunk.max[a] = std::max(chunk.max[a], p[a]);
+                }
+            }
+            lod.chunks.push_back(chunk);
+            if (first + chunk.count >= end) break;
+            first += chunk.count - 1;  // next chunk starts on this one's last vertex
+        }
+        lod.chunkStarts.push_back((int)lod.chunks.size());
+    }
+}
+
+void buildLods(Trajectories& traj, int maxStride) {
+    ProfileZone zone("lods");
+    int longest = 0;
+    for (int c : traj.counts) longest = std::max(longest, c);
+    int levels = 1;
+    for (int stride = 2; stride <= maxStride && stride < longest; stride *= 2) levels++;
+    traj.lods.resize(levels);
+
+    LodLevel& full = traj.lods[0];
+    full.firsts = traj.firsts;
+    full.counts = traj.counts;
+    full.errors.assign(traj.size(), 0.0f);
+    buildChunks(traj, full);
+
+    // Decimated levels add at most half the vertices each, plus one closing vertex per strip
+    size_t fullSize = traj.vertices.size();
+    traj.vertices.reserve(fullSize * 2 + (size_t)traj.size() * 8);
+
+    for (int level = 1, stride = 2; level < levels; level++, stride *= 2) {
+        LodLevel& lod = traj.lods[level];
+        lod.stride = stride;
+        lod.firsts.clear();
+        lod.counts.clear();
+        lod.errors.clear();
+        lod.firsts.reserve(traj.size());
+        lod.counts.reserve(traj.size());
+        lod.errors.reserve(traj.size());
+        for (int t = 0; t < traj.size(); t++) {
+            const int first = traj.firsts[t], count = traj.counts[t];
+            const int lodFirst = (int)traj.vertices.size();
+            float error = 0.0f;
+            // Keep vertex `next`, measuring how far the skipped ones are from the new segment
+            auto keep = [&](int prev, int next) {
+                for (int d = prev + 1; d < next; d++) {
+                    error = std::max(error, segmentDistance(traj.vertices[first + d],
+                                                            traj.vertices[first + prev],
+                                                            traj.vertices[first + next]));
+                }
+                traj.vertices.push_back(traj.vertices[first + next]);
+            };
+
+            int prev = 0;
+            for (int i = 0; i < count; i += stride) {
+                keep(prev, i);
+                prev = i;
+            }
+            // Always end on the real last vertex so the strip keeps its extent
+            if (count > 0 && prev != count - 1) keep(prev, count - 1);
+
+            lod.firsts.push_back(lodFirst);
+            lod.counts.push_back((int)traj.vertices.size() - lodFirst);
+            lod.errors.push_back(error);
+        }
+        buildChunks(traj, lod);
+    }
+}
+
+void quantizeVertices(const Trajectories& traj, CompactVertices& out) {
+    ProfileZone zone("quantize");
+    float scale[3];
+    for (int a = 0; a < 3; a++) {
+        out.origin[a] = traj.boundsMin[a];
+        out.extent[a] = traj.boundsMax[a] - traj.boundsMin[a];
+        scale[a] = out.extent[a] > 0.0f ? 65535.0f / out.extent[a] : 0.0f;
+    }
+    out.maxSpeed = 0.0f;
+    for (const TrajectoryVertex& v : traj.vertices) out.maxSpeed = std::max(out.maxSpeed, v.speed);
+    float speedScale = out.maxSpeed > 0.0f ? 1.0f / out.maxSpeed : 0.0f;
+
+    out.vertices.resize(traj.vertices.size());
+    float maxError2 = 0.0f, maxSpeedError = 0.0f;
+    for (size_t i = 0; i < traj.vertices.size(); i++) {
+        const TrajectoryVertex& v = traj.vertices[i];
+        const float p[3] = {v.x, v.y, v.z};
+        uint16_t q[3];
+        float error2 = 0.0f;
+        for (int a = 0; a < 3; a++) {
+            q[a] = (uint16_t)std::lround(std::clamp((p[a] - out.origin[a]) * scale[a], 0.0f, 65535.0f));
+            float d = out.origin[a] + q[a] / 65535.0f * out.extent[a] - p[a];
+            error2 += d * d;
+        }
+        uint8_t s = (uint8_t)std::lround(std::sqrt(std::clamp(v.speed * speedScale, 0.0f, 1.0f)) * 255.0f);
+        float decoded = (s / 255.0f) * (s / 255.0f) * out.maxSpeed;
+        out.vertices[i] = {q[0], q[1], q[2], s, 0};
+        maxError2 = std::max(maxError2, error2);
+        maxSpeedError = std::max(maxSpeedError, std::abs(decoded - v.speed));
+    }
+    out.maxPositionError = std::sqrt(maxError2);
+    out.maxSpeedError = maxSpeedError;
+}
+
+void benchmarkField(IteratedMap& map, const FieldConfig& config) {
+    Trajectories traj;
+    CompactVertices compact;
+    FieldConfig unsimplified = config;
+    unsimplified.simplify = 0.0f;
+    struct Stage {
+        const char* name;
+        std::function<void()> prepare, run;  // prepare is not timed
+    };
+    auto nothing = [] {};
+    const Stage stages[] = {
+        {"iterate", nothing, [&] { computeField(map, unsimplified, traj); }},
+        {"iterate + simplify", nothing, [&] { computeField(map, config, traj); }},
+        {"LODs", [&] { computeField(map, config, traj); }, [&] { buildLods(traj); }},
+        {"quantize", nothing, [&] { quantizeVertices(traj, compact); }},
+    };
+
+    computeField(map, config, traj);
+    printf("%s, %d seeds x %d iterations (%zu vertices):\n", map.getName(), traj.size(), config.iterations,
+           traj.computedVertices);
+    PerfCounters counters;
+    if (!counters.anyAvailable()) printf("  %s\n", counters.summary().c_str());
+    auto time = [&](const std::string& name, const Stage& stage) {
+        // Best of a few runs, after one warm-up
+        stage.prepare();
+        stage.run();
+        double best = 1e30;
+        std::string bestCounters;
+        for (int i = 0; i < 3; i++) {
+            stage.prepare();
+            counters.start();
+            stage.run();
+            counters.stop();
+            if (counters.seconds < best) {
+                best = counters.seconds;
+                if (counters.anyAvailable()) bestCounters = counters.summary();
+            }
+        }
+        printf("  %-20s %9.2f ms %8.1f M vertices/s  %s\n", name.c_str(), best * 1e3,
+               traj.computedVertices / best / 1e6, bestCounters.c_str());
+    };
+    for (const Stage& stage : stages) time(stage.name, stage);
+
+    // Iteration again with every kernel variant the CPU supports
+    int active = activeIsa();
+    for (int isa = 0; isa < ISA_COUNT; isa++) {
+        if (!selectIsa(isa)) continue;
+        time(std::string("iterate (") + isaName(isa) + ")", stages[0]);
+    }
+    selectIsa(active);
+}
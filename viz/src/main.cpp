@@ -1,43 +1,161 @@
 #include "../inc/utils.hpp"
 #include "../inc/FieldVisualizer.hpp"
+#include "../inc/Colormap.hpp"
+#include "../inc/TextRenderer.hpp"
+#include "../inc/Capture.hpp"
+#include "../inc/Animation.hpp"
+#include "../inc/ImageEncoders.hpp"
+#include "../inc/Seeding.hpp"
+#include "../inc/Profiler.hpp"
+#include "../inc/MapKernels.hpp"
+#include "../inc/Ensemble.hpp"
 
 
 
-int main(int argc, char** argv) {
-    glutInit(&argc, argv);
-    if (!glfwInit()) return -1;
-    GLFWwindow* window = glfwCreateWindow(1280, 720, "Equation Viz", NULL, NULL);
-    glfwMakeContextCurrent(window);
-    glEnable(GL_DEPTH_TEST);
+// Command line options (see printUsage)
+struct Options {
+    std::string mapName = "henon";  // Default
+    FrameRecorder::Format recordFormat = FrameRecorder::PNG;
+    std::string recordOutput;
+    std::string scriptPath, animationOutput = "renders/animation";
+    int hiresScale = 4, hiresSamples = 2;
+    bool benchEncoders = false;
+    int largeResolution = 512, densityGrid = 256;
+    int sampling = SAMPLING_LATTICE, seedCount = 1000;
+    int refineDepth = 5, refineBudget = 40 * 40 * 40;
+    float simplify = -1.0f;  // -1: default, 0.002 (0 when starting with points)
+    bool compareSeeding = false;
+    std::string tracePath;
+    bool benchField = false, countKernels = false;
+    int ensembleMembers = 4;
+    PoincareConfig poincare;
+    bool poincarePlane = false;  // given on the command line, else z = rho - 1
+    std::string poincareExport;
+    bool points = false;
+    float pointSize = 0.004f, pointAlpha = 0.35f;
+    std::string orbitPath;
+    long long orbitPoints = 20000000;
+    float ensembleSpread = 0.1f;
+    std::string cacheDir;  // field cache, off unless given
+    long long cacheMegabytes = 2048;
+};
 
+// The interactive viewer (or the offline mode asked for) in the window's GL context. Everything
+// owning GL objects (field, ensemble, HUD, captures) is local here, so it is destroyed before main
+// terminates GLFW.
+static int runViewer(GLFWwindow* window, const Options& opt, const AnimationScript& script) {
     Camera cam;
-    
-    // Parse command-line argument for map selection
-    std::string mapName = "henon";  // Default
-    if (argc > 1) {
-        mapName = argv[1];
-        if (mapName == "--help" || mapName == "-h") {
-            printUsage(argv[0]);
-            glfwTerminate();
-            return 0;
-        }
-    }
+
     std::unique_ptr<IteratedMap> map;
-    if (mapName == "henon") {
+    if (opt.mapName == "henon") {
         map = std::make_unique<HenonMap>();
-    } else if (mapName == "lorenz") {
+    } else if (opt.mapName == "lorenz") {
         map = std::make_unique<LorenzMap>();
     } else {
         map = std::make_unique<HenonMap>();  // Default
     }
-    
+
     FieldVisualizer field(std::move(map));
     // Initialize field parameters from map defaults
     field.resolution = field.map->getDefaultResolution();
     field.iterations = field.map->getDefaultIterations();
+    field.sampling = opt.sampling;
+    field.seedCount = opt.seedCount;
+    field.refineDepth = opt.refineDepth;
+    field.refineBudget = opt.refineBudget;
+    // Point clouds show every vertex: unsimplified unless asked for. Toggling O later keeps the field as is.
+    field.simplify = opt.simplify >= 0.0f ? opt.simplify : opt.points ? 0.0f : 0.002f;
+    field.countKernels = opt.countKernels;
+    field.points = opt.points;
+    field.pointSize = opt.pointSize;
+    field.pointAlpha = opt.pointAlpha;
+    FieldCache cache;
+    cache.maxBytes = opt.cacheMegabytes << 20;
+    if (!opt.cacheDir.empty() && cache.open(opt.cacheDir)) field.cache = &cache;
+    if (!opt.orbitPath.empty() && !field.loadOrbit(opt.orbitPath, opt.orbitPoints)) {
+        return 1;
+    }
+    Ensemble ensemble;
+    ensemble.members = opt.ensembleMembers;
+    ensemble.spread = opt.ensembleSpread;
+    bool ensembleMode = false;
     double lastUpdate = 0;
 
+    if (opt.compareSeeding) {
+        compareSampling(*field.map, field.config());
+        return 0;
+    }
+
+    // Poincare sections are taken on the flow (Lorenz), by default on z = rho - 1
+    auto* lorenz = dynamic_cast<LorenzMap*>(field.map.get());
+    auto poincareConfig = [&] {
+        PoincareConfig config = opt.poincare;
+        if (!opt.poincarePlane && lorenz) config.value = lorenz->rho - 1.0f;
+        return config;
+    };
+    auto exportPoincare = [&](const std::string& path) {
+        const PoincareHistogram& section = field.poincareSection()->histogram();
+        std::vector<unsigned char> rgb;
+        section.toImage(field.colormap, rgb);
+        if (writePng(path, rgb.data(), section.size, section.size)) printf("Poincare section saved: %s\n", path.c_str());
+        else printf("Failed to save Poincare section.\n");
+    };
+    if (!opt.poincareExport.empty()) {
+        if (!lorenz) {
+            printf("Poincare sections need a flow (lorenz)\n");
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        field.startPoincare(poincareConfig());
+        while (!field.poincareSection()->done()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%lld crossings in %.2f s\n", field.poincareSection()->crossings(), seconds);
+        exportPoincare(opt.poincareExport);
+        return 0;
+    }
+
+    if (opt.benchField) {
+        benchmarkField(*field.map, field.config());
+        return 0;
+    }
+
+    // Encoder benchmark on a rendered 4K frame
+    if (opt.benchEncoders) {
+        OffscreenBuffer frame(3840, 2160);
+        std::vector<unsigned char> pixels((size_t)frame.width * frame.height * 3);
+        frame.bind();
+        renderScene(cam, field, frame.width, frame.height);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, frame.width, frame.height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+        frame.unbind();
+        benchmarkEncoders(pixels.data(), frame.width, frame.height);
+        return 0;
+    }
+
+    if (!opt.scriptPath.empty()) {
+        bool ok = renderAnimation(script, cam, field, opt.animationOutput);
+        return ok ? 0 : 1;
+    }
+
+    // HUD text, laid out in rows from the top-left corner of the framebuffer
+    enum { HUD_MAP, HUD_RESOLUTION, HUD_ITERATIONS, HUD_ORIGIN, HUD_GRID_SIZE,
+           HUD_COLORMAP, HUD_SPEED_SCALE, HUD_LOD, HUD_VERTICES, HUD_CULLED, HUD_BUFFER, HUD_STORE, HUD_RECORDING, HUD_LARGE_FIELD, HUD_SIMPLIFY, HUD_KERNELS, HUD_COUNTERS, HUD_ENSEMBLE, HUD_POINCARE, HUD_DRAW_MODE, HUD_CACHE, HUD_PARAMS };
+    auto hudRow = [](int row) { return 30.0f + row * 20.0f; };
+    TextRenderer hud(GLUT_BITMAP_HELVETICA_12);
+
+    // Screenshots: PBO readback, PNG encoding on a background thread
+    AsyncCapture screenshots(2, 1);
+    FrameRecorder recorder(opt.recordFormat, opt.recordOutput, 60);
+    hud.setText(HUD_MAP, 20, hudRow(0), "Map: " + std::string(field.map->getName()));
+    std::vector<std::string> paramNames = field.map->getParamNames(), paramLabels;
+    for (std::string label : paramNames) {
+        label[0] = (char)toupper(label[0]);
+        paramLabels.push_back(label + ": ");
+    }
+
     while (!glfwWindowShouldClose(window)) {
+        ProfileZone frameZone("frame");
+        ProfileZone inputZone("input");
         double now = glfwGetTime();
         bool ctrl = glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) || glfwGetKey(window, GLFW_KEY_RIGHT_CONTROL);
 
@@ -80,8 +198,20 @@ int main(int argc, char** argv) {
 
         // Params Throttling
         if (now - lastUpdate > 0.1) {
-            if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) { if(ctrl) field.resolution--; else field.resolution++; }
+            if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+                // Lattice (coarse lattice when adaptive): one more / less seed per axis, other strategies: 10% more / less seeds
+                if (field.sampling == SAMPLING_LATTICE || field.sampling == SAMPLING_ADAPTIVE) { if(ctrl) field.resolution--; else field.resolution++; }
+                else if (ctrl) field.seedCount = field.seedCount * 10 / 11;
+                else field.seedCount = std::max(field.seedCount + 1, field.seedCount * 11 / 10);
+            }
             if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) { if(ctrl) field.iterations--; else field.iterations++; }
+            if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS) { if(ctrl) field.speedScale /= 1.1f; else field.speedScale *= 1.1f; }
+            if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) { if(ctrl) field.lodErrorPx -= 0.25f; else field.lodErrorPx += 0.25f; }
+            if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+                // Simplification tolerance: 25% steps, off below 1e-4
+                if (ctrl) field.simplify = field.simplify / 1.25f < 1e-4f ? 0.0f : field.simplify / 1.25f;
+                else field.simplify = std::max(field.simplify * 1.25f, 1e-4f);
+            }
             // Map-specific parameters
             if (auto* henonMap = dynamic_cast<HenonMap*>(field.map.get())) {
                 if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS) { if(ctrl) henonMap->a -= 0.01f; else henonMap->a += 0.01f; }
@@ -93,54 +223,377 @@ int main(int argc, char** argv) {
                 if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) { if(ctrl) lorenzMap->beta -= 0.1f; else lorenzMap->beta += 0.1f; }
             }
             field.resolution = std::clamp(field.resolution, 1, 40);
+            field.seedCount = std::clamp(field.seedCount, 1, 40 * 40 * 40);
             field.iterations = std::clamp(field.iterations, 1, 300);
+            field.lodErrorPx = std::clamp(field.lodErrorPx, 0.0f, 8.0f);
+            if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS) { if(ctrl) field.pointSize /= 1.1f; else field.pointSize *= 1.1f; }
+            field.simplify = std::min(field.simplify, 0.1f);
+            field.pointSize = std::clamp(field.pointSize, 1e-4f, 0.1f);
             lastUpdate = now;
         }
 
-        // Screenshot (press Y)
+        // Screenshot (press Y), high resolution screenshot (Shift+Y) or recording toggle (Ctrl+Y),
+        // captured once the frame is drawn
         static bool yReleased = true;
+        bool screenshotRequested = false, hiresRequested = false, recordToggled = false;
         if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS && yReleased) {
-            save_screenshot(window);
+            bool shift = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) || glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT);
+            if (ctrl) recordToggled = true; else if (shift) hiresRequested = true; else screenshotRequested = true;
             yReleased = false;
         }
         if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_RELEASE) yReleased = true;
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glClearColor(0, 0, 0, 1);
+        // Colormap cycling (press M)
+        static bool mReleased = true;
+        if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS && mReleased) {
+            if (ctrl) field.colormap--; else field.colormap++;
+            mReleased = false;
+        }
+        if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE) mReleased = true;
+
+        // Large-field density (press G to start, again to cancel or go back to trajectories)
+        static bool gReleased = true;
+        if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && gReleased) {
+            if (field.largeFieldActive()) field.stopLargeField(); else field.startLargeField(opt.largeResolution, opt.densityGrid);
+            gReleased = false;
+        }
+        if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE) gReleased = true;
+
+        // Seed strategy cycling (press S)
+        static bool sReleased = true;
+        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS && sReleased) {
+            field.sampling = ((ctrl ? field.sampling - 1 : field.sampling + 1) + SAMPLING_COUNT) % SAMPLING_COUNT;
+            sReleased = false;
+        }
+        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_RELEASE) sReleased = true;
+
+        // Ensemble of parameter values in split viewports (press E), varied parameter cycling (Ctrl+E)
+        static bool eReleased = true;
+        if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS && eReleased) {
+            if (ctrl) ensemble.param = (ensemble.param + 1) % (int)paramNames.size(); else ensembleMode = !ensembleMode;
+            eReleased = false;
+        }
+        if (glfwGetKey(window, GLFW_KEY_E) == GLFW_RELEASE) eReleased = true;
+
+        // Poincare section overlay (press P to start / stop, Shift+P to save it as PNG), Lorenz only
+        static bool pReleased = true;
+        if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && pReleased && lorenz) {
+            bool shift = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) || glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT);
+            if (shift && field.poincareSection()) exportPoincare(screenshotPath("_poincare"));
+            else if (!shift && field.poincareSection()) field.stopPoincare();
+            else if (!shift) field.startPoincare(poincareConfig());
+            pReleased = false;
+        }
+        if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE) pReleased = true;
+
+        // Point cloud / line strips (press O)
+        static bool oReleased = true;
+        if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS && oReleased) {
+            field.points = !field.points;
+            oReleased = false;
+        }
+        if (glfwGetKey(window, GLFW_KEY_O) == GLFW_RELEASE) oReleased = true;
+
+        // Quantized / full precision vertex buffer (press Q)
+        static bool qReleased = true;
+        if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS && qReleased) {
+            field.compact = !field.compact;
+            qReleased = false;
+        }
+        if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_RELEASE) qReleased = true;
+
+        inputZone.end();
+
         int w, h; glfwGetFramebufferSize(window, &w, &h);
-        glViewport(0, 0, w, h);
-        glMatrixMode(GL_PROJECTION); glLoadIdentity();
-        gluPerspective(45.0, (double)w/h, 0.1, 100.0);
-        glMatrixMode(GL_MODELVIEW); glLoadIdentity();
-
-        cam.apply();
-        drawInfiniteGrid(cam.theta, cam.phi, cam.radius);
-        field.drawBox();
-        field.draw();
-
-        // HUD
-        float sy = 690, ls = 20;
-        drawText(20, sy, "Map: " + std::string(field.map->getName()));
-        drawText(20, sy-ls, "Resolution: " + std::to_string(field.resolution));
-        drawText(20, sy-2*ls, "Iterations: " + std::to_string(field.iterations));
-        drawText(20, sy-3*ls, "Origin: [" + std::to_string(field.cx).substr(0,5) + "," + std::to_string(field.cy).substr(0,5) + "," + std::to_string(field.cz).substr(0,5) + "]");
-        drawText(20, sy-4*ls, "Grid Size: " + std::to_string(field.range * 2.0f).substr(0,5));
-        
-        // Display map-specific parameters
-        if (auto* henonMap = dynamic_cast<HenonMap*>(field.map.get())) {
-            drawText(20, sy-5*ls, "Param A: " + std::to_string(henonMap->a).substr(0,6));
-            drawText(20, sy-6*ls, "Param B: " + std::to_string(henonMap->b).substr(0,6));
-        }
-        else if (auto* lorenzMap = dynamic_cast<LorenzMap*>(field.map.get())) {
-            drawText(20, sy-5*ls, "Sigma: " + std::to_string(lorenzMap->sigma).substr(0,6));
-            drawText(20, sy-6*ls, "Rho: " + std::to_string(lorenzMap->rho).substr(0,6));
-            drawText(20, sy-7*ls, "Beta: " + std::to_string(lorenzMap->beta).substr(0,6));
-        }
-
-        glfwSwapBuffers(window);
+        ProfileZone drawZone("draw");
+        if (ensembleMode) ensemble.render(cam, field, w, h); else renderScene(cam, field, w, h);
+        field.drawPoincare(w, h);
+        drawZone.end();
+
+        ProfileZone hudZone("hud");
+
+        // HUD: entries are only reformatted when the values they show change
+        if (hud.changed(HUD_RESOLUTION, {(double)field.resolution, (double)field.sampling, (double)field.seedCount, (double)field.fieldTrajectories()})) {
+            if (field.sampling == SAMPLING_LATTICE)
+                hud.setText(HUD_RESOLUTION, 20, hudRow(1), "Resolution: " + std::to_string(field.resolution));
+            else if (field.sampling == SAMPLING_ADAPTIVE)
+                hud.setText(HUD_RESOLUTION, 20, hudRow(1), "Resolution: " + std::to_string(field.resolution) + " -> "
+                    + std::to_string(std::max(1, field.resolution - 1) * (1 << field.refineDepth) + 1)
+                    + " (Adaptive, " + std::to_string(field.fieldTrajectories()) + " seeds)");
+            else
+                hud.setText(HUD_RESOLUTION, 20, hudRow(1), "Seeds: " + std::to_string(field.seedCount) + " (" + samplingName(field.sampling) + ")");
+        }
+        if (hud.changed(HUD_ITERATIONS, {(double)field.iterations}))
+            hud.setText(HUD_ITERATIONS, 20, hudRow(2), "Iterations: " + std::to_string(field.iterations));
+        if (hud.changed(HUD_ORIGIN, {field.cx, field.cy, field.cz}))
+            hud.setText(HUD_ORIGIN, 20, hudRow(3), "Origin: [" + std::to_string(field.cx).substr(0,5) + "," + std::to_string(field.cy).substr(0,5) + "," + std::to_string(field.cz).substr(0,5) + "]");
+        if (hud.changed(HUD_GRID_SIZE, {field.range}))
+            hud.setText(HUD_GRID_SIZE, 20, hudRow(4), "Grid Size: " + std::to_string(field.range * 2.0f).substr(0,5));
+        if (hud.changed(HUD_COLORMAP, {(double)field.colormap}))
+            hud.setText(HUD_COLORMAP, 250, hudRow(0), "Colormap: " + std::string(colormapName(field.colormap)));
+        if (hud.changed(HUD_SPEED_SCALE, {field.speedScale}))
+            hud.setText(HUD_SPEED_SCALE, 250, hudRow(1), "Speed Scale: " + std::to_string(field.speedScale).substr(0,5));
+        if (hud.changed(HUD_LOD, {field.lodErrorPx}))
+            hud.setText(HUD_LOD, 250, hudRow(2), "LOD Error: " + std::to_string(field.lodErrorPx).substr(0,4) + " px");
+        if (hud.changed(HUD_SIMPLIFY, {field.simplify, (double)field.computedVertices(), (double)field.simplifiedVertices()})) {
+            std::string simplified = "Simplify: off";
+            if (field.simplify > 0.0f && field.computedVertices() > 0)
+                simplified = "Simplify: " + std::to_string(field.simplify).substr(0,6) + " (kept "
+                    + std::to_string(100.0 * field.simplifiedVertices() / field.computedVertices()).substr(0,4) + "% of vertices)";
+            hud.setText(HUD_SIMPLIFY, 250, hudRow(9), simplified);
+        }
+        if (hud.changed(HUD_KERNELS, {(double)activeIsa()}))
+            hud.setText(HUD_KERNELS, 250, hudRow(10), std::string("Kernels: ") + isaName(activeIsa()));
+        // No key: setText compares the text itself
+        if (field.countKernels) hud.setText(HUD_COUNTERS, 250, hudRow(11), "Compute: " + field.computeCounters);
+        long long drawnVertices = ensembleMode ? ensemble.drawnVertices() : field.drawnVertices;
+        long long fieldVertices = ensembleMode ? ensemble.fieldVertices() : field.fieldVertices;
+        if (hud.changed(HUD_VERTICES, {(double)drawnVertices, (double)fieldVertices}))
+            hud.setText(HUD_VERTICES, 250, hudRow(3), "Vertices: " + std::to_string(drawnVertices) + " / " + std::to_string(fieldVertices));
+        int drawnChunks = ensembleMode ? ensemble.drawnChunks() : field.drawnChunks;
+        int culledChunks = ensembleMode ? ensemble.culledChunks() : field.culledChunks;
+        if (hud.changed(HUD_CULLED, {(double)drawnChunks, (double)culledChunks})) {
+            int totalChunks = drawnChunks + culledChunks;
+            float culled = totalChunks ? 100.0f * culledChunks / totalChunks : 0.0f;
+            hud.setText(HUD_CULLED, 250, hudRow(4), "Culled: " + std::to_string(culled).substr(0,4) + "% of " + std::to_string(totalChunks) + " chunks");
+        }
+
+        // Map-specific parameters
+        for (int i = 0; i < (int)paramNames.size(); i++) {
+            float value = field.map->getParam(paramNames[i]);
+            if (hud.changed(HUD_PARAMS + i, {value}))
+                hud.setText(HUD_PARAMS + i, 20, hudRow(5 + i), paramLabels[i] + std::to_string(value).substr(0,6));
+        }
+        // Ensemble: summary, and the varied parameter's value at the bottom of each viewport
+        if (hud.changed(HUD_ENSEMBLE, {(double)ensembleMode, (double)ensemble.param, ensemble.computeMs})) {
+            std::string summary;
+            if (ensembleMode)
+                summary = "Ensemble: " + ensemble.paramName(field) + " -/+" + std::to_string(ensemble.spread * 100.0f).substr(0,4) + "%, "
+                    + std::to_string(ensemble.members) + " members, " + std::to_string(ensemble.computeMs).substr(0,5) + " ms";
+            hud.setText(HUD_ENSEMBLE, 250, hudRow(12), summary);
+        }
+        if (hud.changed(HUD_DRAW_MODE, {(double)field.points, field.pointSize}))
+            hud.setText(HUD_DRAW_MODE, 250, hudRow(14), field.points ? "Draw: points, size " + std::to_string(field.pointSize).substr(0,6) : "Draw: lines");
+        if (cache.enabled() && hud.changed(HUD_CACHE, {(double)cache.hits, (double)cache.misses, (double)cache.files, (double)cache.bytes}))
+            hud.setText(HUD_CACHE, 250, hudRow(15), "Cache: " + std::to_string(cache.hits) + " hits (last " + std::to_string(cache.lastLoadMs).substr(0,5)
+                        + " ms), " + std::to_string(cache.misses) + " misses, " + std::to_string(cache.files.load()) + " fields, "
+                        + std::to_string(cache.bytes.load() / 1e6).substr(0,6) + " MB");
+        PoincareJob* section = field.poincareSection();
+        if (hud.changed(HUD_POINCARE, {(double)(bool)section, section ? std::floor(section->progress() * 1000.0f) : 0.0, section ? (double)section->crossings() : 0.0})) {
+            std::string text;
+            if (section) {
+                text = std::string("Poincare ") + (char)('x' + section->config.axis) + "=" + std::to_string(section->config.value).substr(0,5) + ": ";
+                text += section->done() ? "done" : std::to_string(section->progress() * 100.0f).substr(0,4) + "%";
+                text += ", " + std::to_string(section->crossings()) + " crossings";
+            }
+            hud.setText(HUD_POINCARE, 250, hudRow(13), text);
+        }
+        for (int m = 0; m < Ensemble::MAX_MEMBERS; m++) {
+            int id = HUD_PARAMS + (int)paramNames.size() + m;
+            bool shown = ensembleMode && m < ensemble.members;
+            float value = shown ? ensemble.value(field, m) : 0.0f;
+            if (!hud.changed(id, {(double)shown, value, (double)w, (double)h})) continue;
+            int x = 0, y = 0, vw = 0, vh = 0;
+            if (shown) ensemble.viewport(m, w, h, x, y, vw, vh);
+            hud.setText(id, x + 20.0f, h - y - 15.0f, shown ? ensemble.paramName(field) + " = " + std::to_string(value).substr(0,6) : "");
+        }
+        if (hud.changed(HUD_BUFFER, {(double)field.bufferBytes, field.positionErrorPx, field.colorErrorSteps})) {
+            std::string buffer = "Buffer: " + std::to_string(field.bufferBytes / 1e6).substr(0,5) + " MB";
+            if (field.compact)
+                buffer += ", quantized: " + std::to_string(field.positionErrorPx).substr(0,5) + " px, "
+                        + std::to_string(field.colorErrorSteps).substr(0,4) + " color steps";
+            hud.setText(HUD_BUFFER, 250, hudRow(5), buffer);
+        }
+        if (hud.changed(HUD_STORE, {(double)field.storeBytes(), (double)field.storeHighWater()}))
+            hud.setText(HUD_STORE, 250, hudRow(6), "Store: " + std::to_string(field.storeBytes() / 1e6).substr(0,5) + " MB, high-water "
+                        + std::to_string(field.storeHighWater() / 1e6).substr(0,5) + " MB");
+        float largeProgress = field.largeFieldActive() ? field.largeFieldProgress() : -1.0f;
+        int largeRestarts = field.largeFieldRestarts();
+        if (hud.changed(HUD_LARGE_FIELD, {std::floor(largeProgress * 1000.0f), (double)largeRestarts})) {
+            std::string large;
+            if (largeProgress >= 0.0f) {
+                large = "Large field " + std::to_string(opt.largeResolution) + "^3";
+                if (largeRestarts) large += " (restarted " + std::to_string(largeRestarts) + "x)";
+                large += ": ";
+                large += largeProgress < 1.0f ? std::to_string(largeProgress * 100.0f).substr(0,4) + "%" : "density " + std::to_string(opt.densityGrid) + "^3";
+            }
+            hud.setText(HUD_LARGE_FIELD, 250, hudRow(8), large);
+        }
+        if (recordToggled) {
+            if (recorder.recording()) recorder.stop(); else recorder.start(w, h);
+        }
+        if (hud.changed(HUD_RECORDING, {(double)recorder.recording(), (double)recorder.recorded, (double)recorder.dropped})) {
+            std::string rec;
+            if (recorder.recording()) rec = "REC " + std::to_string(recorder.recorded) + " frames, " + std::to_string(recorder.dropped) + " dropped";
+            hud.setText(HUD_RECORDING, 250, hudRow(7), rec);
+        }
+        hud.draw(w, h);
+        hudZone.end();
+
+        ProfileZone captureZone("screenshot");
+        recorder.frame(w, h);
+        if (screenshotRequested) {
+            std::string path = screenshotPath();
+            bool queued = screenshots.capture(w, h, [path](const unsigned char* pixels, int width, int height) {
+                if (pixels && writePng(path, pixels, width, height)) printf("Screenshot saved: %s\n", path.c_str());
+                else printf("Failed to save screenshot.\n");
+            });
+            if (!queued) printf("Screenshot skipped: previous captures still encoding.\n");
+        }
+        if (hiresRequested) {
+            captureTiled(cam, field, w, h, opt.hiresScale, opt.hiresSamples, screenshotPath("_x" + std::to_string(opt.hiresScale)));
+        }
+
+        captureZone.end();
+
+        {
+            ProfileZone zone("swap");
+            glfwSwapBuffers(window);
+        }
+        screenshots.poll();
+        recorder.poll();
         glfwPollEvents();
+        ProfileZone waitZone("wait");
         while (glfwGetTime() < now + 1.0/60.0);
     }
-    glfwTerminate();
+    if (recorder.recording()) recorder.stop();
+    screenshots.finish();
     return 0;
+}
+
+int main(int argc, char** argv) {
+    glutInit(&argc, argv);
+
+    // Parse command line: [map_name] [options]
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--record-format" && i + 1 < argc) {
+            if (!parseRecordFormat(argv[++i], opt.recordFormat)) {
+                printf("Unknown record format: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (arg == "--record-output" && i + 1 < argc) {
+            opt.recordOutput = argv[++i];
+        } else if (arg == "--hires-scale" && i + 1 < argc) {
+            opt.hiresScale = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--hires-samples" && i + 1 < argc) {
+            opt.hiresSamples = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--large-resolution" && i + 1 < argc) {
+            opt.largeResolution = std::max(2, atoi(argv[++i]));
+        } else if (arg == "--density-grid" && i + 1 < argc) {
+            opt.densityGrid = std::clamp(atoi(argv[++i]), 8, 512);
+        } else if (arg == "--sampling" && i + 1 < argc) {
+            std::string name = argv[++i];
+            for (opt.sampling = 0; opt.sampling < SAMPLING_COUNT; opt.sampling++) {
+                std::string candidate = samplingName(opt.sampling);
+                std::transform(candidate.begin(), candidate.end(), candidate.begin(), ::tolower);
+                if (candidate == name) break;
+            }
+            if (opt.sampling == SAMPLING_COUNT) {
+                printf("Unknown sampling: %s\n", name.c_str());
+                return 1;
+            }
+        } else if (arg == "--seeds" && i + 1 < argc) {
+            opt.seedCount = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--refine-depth" && i + 1 < argc) {
+            opt.refineDepth = std::clamp(atoi(argv[++i]), 0, 10);
+        } else if (arg == "--refine-budget" && i + 1 < argc) {
+            opt.refineBudget = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--simplify" && i + 1 < argc) {
+            opt.simplify = std::max(0.0f, (float)atof(argv[++i]));
+        } else if (arg == "--compare-sampling") {
+            opt.compareSeeding = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            opt.tracePath = argv[++i];
+        } else if (arg == "--huge-pages") {
+            Arena::hugePages = true;
+        } else if (arg == "--bench-field") {
+            opt.benchField = true;
+        } else if (arg == "--isa" && i + 1 < argc) {
+            std::string name = argv[++i];
+            int isa = 0;
+            while (isa < ISA_COUNT && name != isaName(isa)) isa++;
+            if (isa == ISA_COUNT) {
+                printf("Unknown kernel variant: %s\n", name.c_str());
+                return 1;
+            }
+            if (!selectIsa(isa)) {
+                printf("Kernel variant %s is not supported by this CPU\n", name.c_str());
+                return 1;
+            }
+        } else if (arg == "--ensemble" && i + 1 < argc) {
+            opt.ensembleMembers = std::clamp(atoi(argv[++i]), 1, Ensemble::MAX_MEMBERS);
+        } else if (arg == "--ensemble-spread" && i + 1 < argc) {
+            opt.ensembleSpread = std::max(0.0f, (float)atof(argv[++i]));
+        } else if (arg == "--poincare-plane" && i + 1 < argc) {
+            std::string plane = argv[++i];
+            if (plane.size() < 3 || plane[1] != '=' || plane[0] < 'x' || plane[0] > 'z') {
+                printf("Poincare plane must be x=V, y=V or z=V: %s\n", plane.c_str());
+                return 1;
+            }
+            opt.poincare.axis = plane[0] - 'x';
+            opt.poincare.value = (float)atof(plane.c_str() + 2);
+            opt.poincarePlane = true;
+        } else if (arg == "--poincare-iterations" && i + 1 < argc) {
+            opt.poincare.iterations = std::max(1LL, atoll(argv[++i]));
+        } else if (arg == "--poincare-size" && i + 1 < argc) {
+            opt.poincare.size = std::clamp(atoi(argv[++i]), 16, 4096);
+        } else if (arg == "--poincare-export" && i + 1 < argc) {
+            opt.poincareExport = argv[++i];
+        } else if (arg == "--points") {
+            opt.points = true;
+        } else if (arg == "--point-size" && i + 1 < argc) {
+            opt.pointSize = std::max(1e-5f, (float)atof(argv[++i]));
+        } else if (arg == "--point-alpha" && i + 1 < argc) {
+            opt.pointAlpha = std::clamp((float)atof(argv[++i]), 0.001f, 1.0f);
+        } else if (arg == "--orbit" && i + 1 < argc) {
+            opt.orbitPath = argv[++i];
+            opt.points = true;
+        } else if (arg == "--orbit-points" && i + 1 < argc) {
+            opt.orbitPoints = (long long)std::clamp(strtod(argv[++i], nullptr), 2.0, (double)INT_MAX);
+        } else if (arg == "--cache" && i + 1 < argc) {
+            opt.cacheDir = argv[++i];
+        } else if (arg == "--cache-size" && i + 1 < argc) {
+            opt.cacheMegabytes = std::max(0LL, atoll(argv[++i]));
+        } else if (arg == "--counters") {
+            opt.countKernels = true;
+        } else if (arg == "--bench-encoders") {
+            opt.benchEncoders = true;
+        } else if (arg == "--script" && i + 1 < argc) {
+            opt.scriptPath = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            opt.animationOutput = argv[++i];
+        } else {
+            opt.mapName = arg;
+        }
+    }
+
+    if (!opt.tracePath.empty()) {
+        Profiler::start(opt.tracePath);
+        Profiler::setThreadName("main");
+    }
+
+    // Scripted animation: rendered offscreen, the window is only needed for the GL context
+    AnimationScript script;
+    if (!opt.scriptPath.empty()) {
+        if (!script.load(opt.scriptPath)) return 1;
+        if (!script.map.empty()) opt.mapName = script.map;
+    }
+
+    if (!glfwInit()) return -1;
+    if (!opt.scriptPath.empty() || opt.benchEncoders || opt.benchField || opt.compareSeeding || !opt.poincareExport.empty()) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(1280, 720, "Equation Viz", NULL, NULL);
+    glfwMakeContextCurrent(window);
+    glEnable(GL_DEPTH_TEST);
+
+    int status = runViewer(window, opt, script);
+
+    releaseInfiniteGrid();
+    glfwTerminate();
+    Profiler::write();
+    return status;
 }
\ No newline at end of file
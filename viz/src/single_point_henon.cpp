@@ -0,0 +1,247 @@
+// Single orbit tracer: follows one trajectory of a map for up to ~10^10 iterations to sample its
+// invariant measure, after discarding a transient. Memory stays bounded whatever the length: the
+// orbit is either binned into a 2D density histogram (written as PNG) or streamed to a binary
+// point file through a fixed-size buffer.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../inc/HenonMap.hpp"
+#include "../inc/LorenzMap.hpp"
+#include "../inc/Colormap.hpp"
+#include "../inc/ImageEncoders.hpp"
+
+struct Options {
+    std::string mapName = "henon";
+    long long iterations = 1000000000LL, transient = 100000, every = 1;
+    float start[3] = {0.1f, 0.1f, 0.1f};  // map space
+    std::string histogramPath, pointsPath;
+    int size = 2048;
+    int axes[2] = {0, 1};
+    int colormap = 0;
+    std::vector<std::pair<std::string, float>> params;
+};
+
+// Visit counts of the orbit projected on two axes, over [min, max] padded from a preview of the orbit
+struct Histogram {
+    int size = 0;
+    float min[2], max[2], toCell[2];
+    std::vector<uint64_t> counts;
+
+    void add(float u, float v) {
+        float fu = (u - min[0]) * toCell[0], fv = (v - min[1]) * toCell[1];
+        if (!(fu >= 0.0f && fu < (float)size && fv >= 0.0f && fv < (float)size)) return;  // also false for NaN
+        counts[(size_t)std::min((int)fv, size - 1) * size + std::min((int)fu, size - 1)]++;
+    }
+
+    // log(1 + count) through the colormap, empty cells black
+    bool writePng(const std::string& path, int colormap) const {
+        std::vector<unsigned char> lut, rgb((size_t)size * size * 3, 0), png;
+        buildColormap(colormap, lut);
+        uint64_t maxCount = *std::max_element(counts.begin(), counts.end());
+        double norm = maxCount ? 1.0 / std::log1p((double)maxCount) : 0.0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            if (!counts[i]) continue;
+            int entry = std::min(COLORMAP_SIZE - 1, (int)(std::log1p((double)counts[i]) * norm * (COLORMAP_SIZE - 1)));
+            for (int c = 0; c < 3; c++) rgb[i * 3 + c] = lut[entry * 3 + c];
+        }
+        return encodePng(rgb.data(), size, size, png) && writeFile(path, png);
+    }
+};
+
+static double seconds(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+// Map is the concrete type so iterate() is inlined into the loops
+template <class Map>
+static int traceOrbit(Map map, const Options& opt) {
+    float x = opt.start[0], y = opt.start[1], z = opt.start[2];
+    for (long long n = 0; n < opt.transient; n++) {
+        map.iterate(x, y, z);
+        if (map.hasEscaped(x, y, z)) {
+            printf("Orbit escaped during the transient (iteration %lld)\n", n);
+            return 1;
+        }
+    }
+
+    Histogram histogram;
+    if (!opt.histogramPath.empty()) {
+        // Bounds: a short preview continuing from the same state, padded by 5%
+        float lo[2] = {INFINITY, INFINITY}, hi[2] = {-INFINITY, -INFINITY};
+        float px = x, py = y, pz = z;
+        for (long long n = 0; n < std::min(opt.iterations, 1000000LL); n++) {
+            map.iterate(px, py, pz);
+            if (map.hasEscaped(px, py, pz)) break;
+            const float p[3] = {px, py, pz};
+            for (int a = 0; a < 2; a++) {
+                lo[a] = std::min(lo[a], p[opt.axes[a]]);
+                hi[a] = std::max(hi[a], p[opt.axes[a]]);
+            }
+        }
+        histogram.size = opt.size;
+        for (int a = 0; a < 2; a++) {
+            if (lo[a] > hi[a]) { lo[a] = -1.0f; hi[a] = 1.0f; }
+            float pad = std::max(0.05f * (hi[a] - lo[a]), 1e-6f);
+            histogram.min[a] = lo[a] - pad;
+            histogram.max[a] = hi[a] + pad;
+            histogram.toCell[a] = opt.size / (histogram.max[a] - histogram.min[a]);
+        }
+        histogram.counts.assign((size_t)opt.size * opt.size, 0);
+    }
+
+    FILE* points = nullptr;
+    std::vector<float> buffer;
+    if (!opt.pointsPath.empty()) {
+        points = fopen(opt.pointsPath.c_str(), "wb");
+        if (!points) {
+            printf("Could not open %s\n", opt.pointsPath.c_str());
+            return 1;
+        }
+        buffer.reserve(3 << 16);
+    }
+
+    // Blocks of iterations between progress reports
+    const long long block = 1LL << 24;
+    auto start = std::chrono::steady_clock::now();
+    long long done = 0, written = 0;
+    bool escaped = false;
+    while (done < opt.iterations && !escaped) {
+        long long count = std::min(block, opt.iterations - done);
+        long long n = 0;
+        if (points) {
+            for (; n < count; n++) {
+                map.iterate(x, y, z);
+                if (!histogram.counts.empty()) {
+                    const float p[3] = {x, y, z};
+                    histogram.add(p[opt.axes[0]], p[opt.axes[1]]);
+                }
+                if ((done + n) % opt.every == 0) {
+                    buffer.insert(buffer.end(), {x, y, z});
+                    if (buffer.size() == buffer.capacity()) {
+                        written += (long long)fwrite(buffer.data(), sizeof(float) * 3, buffer.size() / 3, points);
+                        buffer.clear();
+                    }
+                }
+                if (map.hasEscaped(x, y, z)) { escaped = true; n++; break; }
+            }
+        } else {
+            for (; n < count; n++) {
+                map.iterate(x, y, z);
+                const float p[3] = {x, y, z};
+                histogram.add(p[opt.axes[0]], p[opt.axes[1]]);
+                if (map.hasEscaped(x, y, z)) { escaped = true; n++; break; }
+            }
+        }
+        done += n;
+        double elapsed = seconds(start);
+        fprintf(stderr, "\r%5.1f%%  %lld iterations  %.1f M iterations/s ", 100.0 * done / opt.iterations, done,
+                done / elapsed / 1e6);
+    }
+    fprintf(stderr, "\n");
+    double elapsed = seconds(start);
+
+    if (escaped) printf("Orbit escaped after %lld iterations\n", done);
+    printf("%s: %lld iterations in %.2f s (%.1f M iterations/s)\n", map.getName(), done, elapsed, done / elapsed / 1e6);
+    if (points) {
+        written += (long long)fwrite(buffer.data(), sizeof(float) * 3, buffer.size() / 3, points);
+        fclose(points);
+        printf("%lld points (float32 x y z) written to %s\n", written, opt.pointsPath.c_str());
+    }
+    if (!opt.histogramPath.empty()) {
+        if (!histogram.writePng(opt.histogramPath, opt.colormap)) {
+            printf("Could not write %s\n", opt.histogramPath.c_str());
+            return 1;
+        }
+        printf("%dx%d histogram of %c%c over [%g, %g] x [%g, %g] written to %s\n", opt.size, opt.size,
+               'x' + opt.axes[0], 'x' + opt.axes[1], histogram.min[0], histogram.max[0], histogram.min[1],
+               histogram.max[1], opt.histogramPath.c_str());
+    }
+    return 0;
+}
+
+template <class Map>
+static int run(Options& opt) {
+    Map map;
+    for (const auto& [name, value] : opt.params) map.setParam(name, value);
+    if (opt.histogramPath.empty() && opt.pointsPath.empty())
+        opt.histogramPath = "renders/single_point_" + opt.mapName + ".png";
+    return traceOrbit(map, opt);
+}
+
+static void printUsage(const char* progName) {
+    printf("Usage: %s [map_name] [options]\n", progName);
+    printf("\nAvailable maps:\n");
+    printf("  henon     - Henon map (default)\n");
+    printf("  lorenz    - Lorenz attractor\n");
+    printf("\nOptions:\n");
+    printf("  --iterations N               Orbit length, e.g. 1e10 (default 1e9)\n");
+    printf("  --transient N                Leading iterations discarded (default 1e5)\n");
+    printf("  --start X,Y,Z                Initial point, map space (default 0.1,0.1,0.1)\n");
+    printf("  --param NAME=VALUE           Map parameter, e.g. a=1.4 (repeatable)\n");
+    printf("  --histogram FILE             Density histogram PNG (default renders/single_point_<map>.png)\n");
+    printf("  --size N                     Histogram cells per side (default 2048)\n");
+    printf("  --axes AB                    Projected axes of the histogram: xy (default), xz or yz\n");
+    printf("  --colormap N                 Histogram colormap index (default 0)\n");
+    printf("  --points FILE                Stream the orbit as float32 x y z triples (histogram only if also given)\n");
+    printf("  --every K                    Write every K-th point only (default 1)\n");
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            opt.iterations = std::max(1LL, (long long)strtod(argv[++i], nullptr));
+        } else if (arg == "--transient" && i + 1 < argc) {
+            opt.transient = std::max(0LL, (long long)strtod(argv[++i], nullptr));
+        } else if (arg == "--start" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%f,%f,%f", &opt.start[0], &opt.start[1], &opt.start[2]) != 3) {
+                printf("Start point must be X,Y,Z: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (arg == "--param" && i + 1 < argc) {
+            std::string param = argv[++i];
+            size_t equals = param.find('=');
+            if (equals == std::string::npos) {
+                printf("Parameter must be NAME=VALUE: %s\n", param.c_str());
+                return 1;
+            }
+            opt.params.push_back({param.substr(0, equals), (float)atof(param.c_str() + equals + 1)});
+        } else if (arg == "--histogram" && i + 1 < argc) {
+            opt.histogramPath = argv[++i];
+        } else if (arg == "--size" && i + 1 < argc) {
+            opt.size = std::clamp(atoi(argv[++i]), 16, 16384);
+        } else if (arg == "--axes" && i + 1 < argc) {
+            std::string axes = argv[++i];
+            if (axes.size() != 2 || axes[0] < 'x' || axes[0] > 'z' || axes[1] < 'x' || axes[1] > 'z' || axes[0] == axes[1]) {
+                printf("Axes must be two of x, y, z: %s\n", axes.c_str());
+                return 1;
+            }
+            opt.axes[0] = axes[0] - 'x';
+            opt.axes[1] = axes[1] - 'x';
+        } else if (arg == "--colormap" && i + 1 < argc) {
+            opt.colormap = std::clamp(atoi(argv[++i]), 0, colormapCount() - 1);
+        } else if (arg == "--points" && i + 1 < argc) {
+            opt.pointsPath = argv[++i];
+        } else if (arg == "--every" && i + 1 < argc) {
+            opt.every = std::max(1LL, atoll(argv[++i]));
+        } else {
+            opt.mapName = arg;
+        }
+    }
+
+    if (opt.mapName == "henon") return run<HenonMap>(opt);
+    if (opt.mapName == "lorenz") return run<LorenzMap>(opt);
+    printf("Unknown map: %s\n", opt.mapName.c_str());
+    return 1;
+}
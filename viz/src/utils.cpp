@@ -1,15 +1,12 @@
 #include <cmath>
 #include <vector>
 #include <cstdio>
-#include <ctime>
 #include <algorithm>
 
-#include <GL/freeglut.h>
 #include <GL/glu.h>
 
 #include "../inc/utils.hpp"
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "../inc/stb_image_write.h"
+#include "../inc/MapKernels.hpp"
 
 
 void Camera::update(GLFWwindow* window, bool ctrl) {
@@ -22,67 +19,157 @@ void Camera::update(GLFWwindow* window, bool ctrl) {
 }
 
 void Camera::apply() {
-    float x = radius * sin(phi) * cos(theta);
-    float y = radius * cos(phi);
-    float z = radius * sin(phi) * sin(theta);
+    float x, y, z;
+    eye(x, y, z);
     gluLookAt(x, y, z, 0, 0, 0, 0, 1, 0);
 }
 
+void Camera::eye(float& x, float& y, float& z) const {
+    x = radius * sin(phi) * cos(theta);
+    y = radius * cos(phi);
+    z = radius * sin(phi) * sin(theta);
+}
+
+float Camera::pixelsPerUnit(float distance, int viewportHeight) const {
+    float halfHeight = std::max(distance, zNear) * tan(fov * 0.5f * (float)M_PI / 180.0f);
+    return viewportHeight * 0.5f / halfHeight;
+}
+
+void Frustum::extract() {
+    float proj[16], view[16], clip[16];
+    glGetFloatv(GL_PROJECTION_MATRIX, proj);
+    glGetFloatv(GL_MODELVIEW_MATRIX, view);
+    // Column-major: clip = proj * view
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            clip[c*4 + r] = 0.0f;
+            for (int k = 0; k < 4; k++) clip[c*4 + r] += proj[k*4 + r] * view[c*4 + k];
+        }
+    }
+    // Planes are row 3 +/- rows 0 (left/right), 1 (bottom/top), 2 (near/far)
+    for (int i = 0; i < 6; i++) {
+        int row = i / 2;
+        float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+        float len = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            planes[i][c] = clip[c*4 + 3] + sign * clip[c*4 + row];
+            if (c < 3) len += planes[i][c] * planes[i][c];
+        }
+        len = sqrt(len);
+        for (int c = 0; c < 4; c++) planes[i][c] /= len;
+    }
+}
+
+bool Frustum::intersects(const float min[3], const float max[3]) const {
+    for (int i = 0; i < 6; i++) {
+        // Box corner furthest along the plane normal
+        float px = planes[i][0] >= 0 ? max[0] : min[0];
+        float py = planes[i][1] >= 0 ? max[1] : min[1];
+        float pz = planes[i][2] >= 0 ? max[2] : min[2];
+        if (planes[i][0]*px + planes[i][1]*py + planes[i][2]*pz + planes[i][3] < 0) return false;
+    }
+    return true;
+}
+
+LineMesh::~LineMesh() {
+    release();
+}
+
+void LineMesh::release() {
+    if (vbo) glDeleteBuffers(1, &vbo);
+    vbo = 0;
+    count = 0;
+}
+
+void LineMesh::upload(const std::vector<float>& xyz) {
+    if (!vbo) glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, xyz.size() * sizeof(float), xyz.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    count = (int)(xyz.size() / 3);
+}
+
+void LineMesh::draw() const {
+    if (!count) return;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, (void*)0);
+    glDrawArrays(GL_LINES, 0, count);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Built once around the origin, then re-centred on the camera cell with a translation
+static LineMesh grid;
+
 void drawInfiniteGrid(float camTheta, float camPhi, float camRadius) {
     float camX = camRadius * sin(camPhi) * cos(camTheta);
     float camZ = camRadius * sin(camPhi) * sin(camTheta);
     float size = 20.0f, step = 0.5f;
     float offsetX = floor(camX / step) * step;
     float offsetZ = floor(camZ / step) * step;
-    glBegin(GL_LINES);
-    glColor4f(0.15f, 0.15f, 0.15f, 0.4f);
-    for (float i = -size; i <= size; i += step) {
-        glVertex3f(i + offsetX, 0, -size + offsetZ); glVertex3f(i + offsetX, 0, size + offsetZ);
-        glVertex3f(-size + offsetX, 0, i + offsetZ); glVertex3f(size + offsetX, 0, i + offsetZ);
-    }
-    glEnd();
-}
-
-void drawText(float x, float y, std::string text) {
-    glMatrixMode(GL_PROJECTION); glPushMatrix(); glLoadIdentity();
-    gluOrtho2D(0, 1280, 0, 720);
-    glMatrixMode(GL_MODELVIEW); glPushMatrix(); glLoadIdentity();
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glRasterPos2f(x, y);
-    for (char c : text) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, (unsigned char)c);
-    glPopMatrix(); glMatrixMode(GL_PROJECTION); glPopMatrix(); glMatrixMode(GL_MODELVIEW);
-}
 
-void save_screenshot(GLFWwindow* window) {
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-    // 3 bytes per pixel (RGB)
-    std::vector<unsigned char> pixels(3 * width * height);
-    glPixelStorei(GL_PACK_ALIGNMENT, 1);
-    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
-
-    // OpenGL images are upside down, so we flip the rows
-    std::vector<unsigned char> flippedPixels(3 * width * height);
-    for (int row = 0; row < height; row++) {
-        memcpy(&flippedPixels[row * width * 3], 
-               &pixels[(height - row - 1) * width * 3], 
-               width * 3);
+    if (grid.empty()) {
+        std::vector<float> xyz;
+        for (float i = -size; i <= size; i += step) {
+            xyz.insert(xyz.end(), {i, 0, -size,  i, 0, size});
+            xyz.insert(xyz.end(), {-size, 0, i,  size, 0, i});
+        }
+        grid.upload(xyz);
     }
 
-    time_t now = time(0);
-    char filename[100];
-    strftime(filename, sizeof(filename), "renders/flow_map_%Y%m%d_%H%M%S.png", localtime(&now));
+    glPushMatrix();
+    glTranslatef(offsetX, 0, offsetZ);
+    glColor4f(0.15f, 0.15f, 0.15f, 0.4f);
+    grid.draw();
+    glPopMatrix();
+}
 
-    if (stbi_write_png(filename, width, height, 3, flippedPixels.data(), width * 3)) {
-        printf("Screenshot saved: %s\n", filename);
-    } else {
-        printf("Failed to save screenshot.\n");
-    }
+void releaseInfiniteGrid() {
+    grid.release();
 }
 
 void printUsage(const char* progName) {
-    printf("Usage: %s [map_name]\n", progName);
+    printf("Usage: %s [map_name] [options]\n", progName);
     printf("\nAvailable maps:\n");
     printf("  henon     - Henon map (default)\n");
     printf("  lorenz    - Lorenz attractor\n");
+    printf("\nOptions:\n");
+    printf("  --record-format FORMAT       Format used by Ctrl+Y recording: png (default), png-fast,\n");
+    printf("                               png-store (uncompressed), qoi, ppm or y4m\n");
+    printf("  --record-output PATH         Directory (png/ppm), file or \"|command\" pipe (y4m)\n");
+    printf("  --hires-scale N              Shift+Y screenshot size, in window sizes (default 4)\n");
+    printf("  --hires-samples N            Shift+Y supersampling per axis (default 2)\n");
+    printf("  --sampling NAME              Seed placement: lattice (default), halton, sobol, jittered or adaptive\n");
+    printf("  --seeds N                    Seed count of the non-lattice strategies (default 1000)\n");
+    printf("  --refine-depth N             Adaptive sampling: max splits of a coarse lattice cell (default 5)\n");
+    printf("  --refine-budget N            Adaptive sampling: max seeds (default 64000)\n");
+    printf("  --simplify W                 Trajectory simplification tolerance, visualization units (default 0.002, 0 with --points, 0 = off)\n");
+    printf("  --compare-sampling           Print trajectory coverage vs seed count per strategy and exit\n");
+    printf("  --large-resolution N         Lattice resolution of the G large-field density (default 512)\n");
+    printf("  --density-grid N             Voxels per axis of the large-field density, 8-512 (default 256)\n");
+    printf("  --bench-field                Time every stage of the field computation with hardware counters and exit\n");
+    printf("  --ensemble N                 Parameter values side by side in ensemble mode (E), 1-16 (default 4)\n");
+    printf("  --ensemble-spread F          Ensemble values span the parameter -/+ F, relative (default 0.1)\n");
+    printf("  --poincare-plane A=V         Poincare section plane (P, lorenz): x, y or z = V (default z = rho - 1)\n");
+    printf("  --poincare-iterations N      Iterations followed per seed (default 100000, the first 1000 discarded)\n");
+    printf("  --poincare-size N            Poincare histogram cells per side (default 512)\n");
+    printf("  --poincare-export FILE       Compute the Poincare section of the field's seeds, save it as PNG and exit\n");
+    printf("  --points                     Start in point cloud mode (O) instead of line strips\n");
+    printf("  --point-size W               Point size in visualization units, attenuated with distance (default 0.004)\n");
+    printf("  --point-alpha A              Opacity each point adds, lower for dense orbits (default 0.35)\n");
+    printf("  --orbit FILE                 Show an orbit written by single_point_henon --points, as points\n");
+    printf("  --orbit-points N             Longer orbits are read every k-th point down to N points (default 2e7)\n");
+    printf("  --cache DIR                  Keep computed fields in DIR and reuse them, e.g. ~/.cache/equation_viz (default off)\n");
+    printf("  --cache-size MB              Cache size limit, least recently used fields removed first (default 2048)\n");
+    printf("  --counters                   Show hardware counters of each field computation on the HUD\n");
+    printf("  --isa NAME                   Map kernel variant (default: the best supported):");
+    for (int isa = 0; isa < ISA_COUNT; isa++)
+        printf(" %s%s", isaName(isa), !isaSupported(isa) ? " (unsupported)" : isa == activeIsa() ? " (default)" : "");
+    printf("\n");
+    printf("  --trace FILE                 Record profiling zones, written as Chrome trace-event JSON on exit\n");
+    printf("  --huge-pages                 Back trajectory storage with transparent huge pages\n");
+    printf("  --bench-encoders             Time every image encoder on a rendered 4K frame and exit\n");
+    printf("  --script FILE                Render a keyframed animation offscreen and exit\n");
+    printf("  --out DIR                    Animation frames directory (default renders/animation)\n");
 }
\ No newline at end of file